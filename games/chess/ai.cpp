@@ -12,6 +12,9 @@
 #include "ai.h"
 #include "minimax.h"
 #include "globals.h"
+#include "attacks.h"
+#include "ttable.h"
+#include "threadpool.h"
 #include "fathom/tbprobe.h"
 #include "fathom/tbaccess.h"
 #include <fstream>
@@ -79,6 +82,21 @@ void Chess::AI::start()
 		}	
 	fileIn.close();
 
+	// Build move generation and hashing tables
+	initAttacks();
+	initZobrist();
+	tt.resize( ttSizeMb );
+
+	// Spin up the search threads now, so that no thread is
+	// ever created on our clock. The calling thread searches
+	// too, so it isn't counted.
+	int numThreads = threads;
+	if( numThreads <= 0 )
+		{
+		numThreads = std::max( ( int )std::thread::hardware_concurrency(), 1 );
+		}
+	pool.start( numThreads - 1, poolAffinity != 0 );
+
 	return;
 	}
 
@@ -103,6 +121,7 @@ void Chess::AI::gameUpdated() {}
 void Chess::AI::ended( bool won, std::string reason ) 
 	{
 	printBoard();
+	pool.stop();
 	}
 
 
@@ -142,7 +161,7 @@ bool Chess::AI::runTurn()
 
 	// Build initial state for this move
 	Chess::State initial( this );
-	Chess::State bestAction;
+	Action bestAction = NULL_ACTION;
 	bool err = false;
 	bool endGame = false;
 
@@ -154,7 +173,7 @@ bool Chess::AI::runTurn()
 			{
 
 			// Probe endgame table
-			Chess::State tablebaseMove = initial;
+			Action tablebaseMove = NULL_ACTION;
 			err = probeTablebases( &tablebaseMove );		// Still sometimes fails unexpectantly, or makes a dumb move (idk why...)
 
 			// Execute move, or fallback to minimax
@@ -164,7 +183,7 @@ bool Chess::AI::runTurn()
 				}
 			else
 				{
-				executeMove( &tablebaseMove );
+				executeMove( tablebaseMove );
 				}
 			}
 		}
@@ -176,7 +195,7 @@ bool Chess::AI::runTurn()
 		id_minimax( &initial, &bestAction, this->player->timeRemaining );
 
 		// Make our chosen move
-		executeMove( &bestAction );
+		executeMove( bestAction );
 
 		// Print node stats
 		int pruned, expanded, expandedNQ, depth;
@@ -184,7 +203,7 @@ bool Chess::AI::runTurn()
 		std::cout << "Statistics: " << std::endl;
 		std::cout << "  Pruned Nodes: " << pruned << std::endl;
 		std::cout << "  Expanded Nodes: " << expanded << std::endl;
-		std::cout << "  Expanded NonQuiescent Nodes: " << expandedNQ << std::endl;
+		std::cout << "  Expanded Quiescence Nodes: " << expandedNQ << std::endl;
 		int end_ms = start_ms - ( this->player->timeRemaining / 1000000 );
 		std::cout << "  Time Spent: " << end_ms / 1000 << "." << end_ms % 1000 << "s" << std::endl;
 		std::cout << "  Depth Achieved: " << depth - 1 << std::endl;
@@ -203,11 +222,13 @@ bool Chess::AI::runTurn()
 * Performs the logic to translate potential moves and send
 * the chosen move to the game server
 **************************************************************/
-bool Chess::AI::executeMove( Chess::State* move )
+bool Chess::AI::executeMove( Action move )
 	{
+	static const std::string promotionNames[ 4 ] = { "Knight", "Bishop", "Rook", "Queen" };
 	int idx;
-	int toIdx = ( move->misc.to_ullong() & TOIDX_MASK ) >> TOIDX_BITSHIFT;
-	int fromIdx = ( move->misc.to_ullong() & FROMIDX_MASK ) >> FROMIDX_BITSHIFT;
+	int toIdx = ACTION_TO( move );
+	int fromIdx = ACTION_FROM( move );
+	std::string promotion = ( IS_PROMOTION( move ) ? promotionNames[ ACTION_FLAGS( move ) & 0x3 ] : "" );
 	std::vector<Chess::Piece*>::iterator runner = this->player->pieces.begin();
 	std::vector<Chess::Piece*>::iterator last = this->player->pieces.end();
 	for( runner; runner != last; runner++ )
@@ -220,7 +241,7 @@ bool Chess::AI::executeMove( Chess::State* move )
 			std::cout << "  Moving " << ( *runner )->type << " at "
 					  << ( *runner )->file << ( *runner )->rank
 					  << " to " << toFile << toRank << std::endl;
-			return ( *runner )->move( toFile, toRank, "Queen" );
+			return ( *runner )->move( toFile, toRank, promotion );
 			}
 		}
 	return false;
@@ -295,7 +316,7 @@ void Chess::AI::printBoard()
 * Probe Tablebases
 * Looks to endgame tablebases for best move.
 **************************************************************/
-bool Chess::AI::probeTablebases( Chess::State* rtnState )
+bool Chess::AI::probeTablebases( Action* rtnAction )
 	{
 	std::cout << "Probing endgame tables:" << std::endl;
 	unsigned result, altResult;
@@ -333,10 +354,14 @@ bool Chess::AI::probeTablebases( Chess::State* rtnState )
 		{
 		std::cout << TB_GET_FROM( result ) << " to " << TB_GET_TO( result ) << std::endl;
 		
-		// Convert to/from to a chess state so that the move can be executed
-		rtnState->misc = 0;
-		rtnState->misc |= ( ( ( unsigned long long )TB_GET_FROM( result ) ) << FROMIDX_BITSHIFT );
-		rtnState->misc |= ( ( ( unsigned long long )TB_GET_TO( result ) ) << TOIDX_BITSHIFT );
+		// Convert to/from to an action so that the move can be executed
+		int flags = QUIET;
+		if( TB_GET_PROMOTES( result ) != TB_PROMOTES_NONE )
+			{
+			flags = PROMOTION | ( TB_PROMOTES_KNIGHT - TB_GET_PROMOTES( result ) );
+			}
+		// Only the squares and promotion are needed by executeMove()
+		*rtnAction = ACTION( TB_GET_FROM( result ), TB_GET_TO( result ), flags, NO_PIECE, NO_PIECE );
 		}
 	else
 		{
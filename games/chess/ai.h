@@ -62,9 +62,9 @@ class Chess::AI : public Joueur::BaseAI
         /// <returns>Represents if you want to end your turn. True means end your turn, False means to keep your turn going and re-call this function.</returns>
         bool runTurn();
 
-		bool executeMove( Chess::State * move );
+		bool executeMove( Action move );
 		void printBoard();
-		bool probeTablebases( Chess::State * rtnState );
+		bool probeTablebases( Action * rtnAction );
 };
 
 #endif
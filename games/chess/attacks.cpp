@@ -0,0 +1,236 @@
+/**************************************************************
+* attacks.cpp
+* Definitions for the precomputed chess attack tables
+* CS5400, FS 2016
+* Stuart Miller
+**************************************************************/
+
+
+/******************************************************
+* Includes
+******************************************************/
+#include "attacks.h"
+
+
+/******************************************************
+* Local Variables
+******************************************************/
+static bool initialized = false;
+static Bitboard rookTable[ ROOK_TABLE_SZ ];
+static Bitboard bishopTable[ BISHOP_TABLE_SZ ];
+static const int rookDirs[ 4 ][ 2 ]		= { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+static const int bishopDirs[ 4 ][ 2 ]	= { { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 } };
+static const int knightDirs[ 8 ][ 2 ]	= { { 1, 2 }, { 2, 1 }, { 2, -1 }, { 1, -2 }, { -1, -2 }, { -2, -1 }, { -2, 1 }, { -1, 2 } };
+static const int kingDirs[ 8 ][ 2 ]		= { { 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 }, { -1, 0 }, { -1, -1 }, { 0, -1 }, { 1, -1 } };
+static const int pawnDirs[ 2 ][ 2 ][ 2 ]= { { { -1, 1 }, { 1, 1 } }, { { -1, -1 }, { 1, -1 } } };
+static const Bitboard rankSeeds[ 8 ] = { 728, 10316, 55013, 32803, 12281, 15100, 16645, 255 };
+
+
+/******************************************************
+* Global Attack Tables
+******************************************************/
+Magic		rookMagics[ 64 ];
+Magic		bishopMagics[ 64 ];
+Bitboard	knightAttacks[ 64 ];
+Bitboard	kingAttacks[ 64 ];
+Bitboard	pawnAttacks[ 2 ][ 64 ];
+Bitboard	betweenBB[ 64 ][ 64 ];
+Bitboard	lineBB[ 64 ][ 64 ];
+
+
+/******************************************************
+* Step Attacks
+* Builds an attack set from a list of single step
+* offsets given as ( file, rank ) pairs
+******************************************************/
+static Bitboard stepAttacks( int sq, const int dirs[][ 2 ], int numDirs )
+	{
+	Bitboard result = 0;
+	int file, rank, i;
+	for( i = 0; i < numDirs; i++ )
+		{
+		file = ( sq % 8 ) + dirs[ i ][ 0 ];
+		rank = ( sq / 8 ) + dirs[ i ][ 1 ];
+		if( file >= 0 && file <= 7 && rank >= 0 && rank <= 7 )
+			result |= BIT( file + ( rank * 8 ) );
+		}
+	return result;
+	}
+
+
+/******************************************************
+* Slide Attacks
+* Walks each ray from sq until the edge of the board
+* or a blocker in occ is hit. Only used to fill the
+* tables at startup.
+******************************************************/
+static Bitboard slideAttacks( int sq, Bitboard occ, const int dirs[][ 2 ] )
+	{
+	Bitboard result = 0;
+	Bitboard bit;
+	int file, rank, i;
+	for( i = 0; i < 4; i++ )
+		{
+		file = ( sq % 8 ) + dirs[ i ][ 0 ];
+		rank = ( sq / 8 ) + dirs[ i ][ 1 ];
+		while( file >= 0 && file <= 7 && rank >= 0 && rank <= 7 )
+			{
+			bit = BIT( file + ( rank * 8 ) );
+			result |= bit;
+			if( occ & bit )
+				break;
+			file += dirs[ i ][ 0 ];
+			rank += dirs[ i ][ 1 ];
+			}
+		}
+	return result;
+	}
+
+
+/******************************************************
+* Relevant Occupancy Mask
+* Squares whose occupancy can change the attack set of
+* a slider on sq. Board edges are excluded, since a
+* piece there can never block anything further out.
+******************************************************/
+static Bitboard occupancyMask( int sq, const int dirs[][ 2 ] )
+	{
+	Bitboard result = 0;
+	int file, rank, i;
+	for( i = 0; i < 4; i++ )
+		{
+		file = ( sq % 8 ) + dirs[ i ][ 0 ];
+		rank = ( sq / 8 ) + dirs[ i ][ 1 ];
+		while( file + dirs[ i ][ 0 ] >= 0 && file + dirs[ i ][ 0 ] <= 7 &&
+			   rank + dirs[ i ][ 1 ] >= 0 && rank + dirs[ i ][ 1 ] <= 7 )
+			{
+			result |= BIT( file + ( rank * 8 ) );
+			file += dirs[ i ][ 0 ];
+			rank += dirs[ i ][ 1 ];
+			}
+		}
+	return result;
+	}
+
+
+/******************************************************
+* Initialize Magics
+* Searches for a magic number per square that maps
+* every blocker subset of the mask onto a slice of
+* table without destructive collisions.
+******************************************************/
+static void initMagics( Magic* magics, Bitboard* table, const int dirs[][ 2 ] )
+	{
+	static Bitboard occupancy[ 4096 ];
+	static Bitboard reference[ 4096 ];
+	static int epoch[ 4096 ];
+	int attempt = 0;
+	int sq, size, i, idx;
+	Bitboard subset;
+	Bitboard seed;
+	Bitboard* slice = table;
+
+	for( i = 0; i < 4096; i++ )
+		epoch[ i ] = 0;
+
+	for( sq = 0; sq < 64; sq++ )
+		{
+		Magic& m	= magics[ sq ];
+		m.mask		= occupancyMask( sq, dirs );
+		m.shift		= 64 - popCount( m.mask );
+		m.attacks	= slice;
+
+		// Reseed per square with values known to converge
+		// quickly, so the same magics are found every run
+		seed		= rankSeeds[ sq / 8 ];
+
+		// Enumerate every subset of the mask (Carry-Rippler)
+		size = 0;
+		subset = 0;
+		do
+			{
+			occupancy[ size ] = subset;
+			reference[ size ] = slideAttacks( sq, subset, dirs );
+			size++;
+			subset = ( subset - m.mask ) & m.mask;
+			} while( subset );
+
+		// Try sparse random numbers until one maps cleanly
+		for( i = 0; i < size; )
+			{
+			do
+				{
+				m.magic = random64( seed ) & random64( seed ) & random64( seed );
+				} while( popCount( ( m.mask * m.magic ) >> 56 ) < 6 );
+
+			attempt++;
+			for( i = 0; i < size; i++ )
+				{
+				idx = ( int )( ( occupancy[ i ] * m.magic ) >> m.shift );
+				if( epoch[ idx ] < attempt )
+					{
+					epoch[ idx ] = attempt;
+					m.attacks[ idx ] = reference[ i ];
+					}
+				else if( m.attacks[ idx ] != reference[ i ] )
+					{
+					break;
+					}
+				}
+			}
+		slice += size;
+		}
+	return;
+	}
+
+
+/******************************************************
+* Initialize Attack Tables
+* Fills the leaper and slider tables. Only needs to be
+* called once per process, before any move generation.
+******************************************************/
+void initAttacks()
+	{
+	if( initialized )
+		{
+		return;
+		}
+
+	int sq, to;
+	for( sq = 0; sq < 64; sq++ )
+		{
+		knightAttacks[ sq ]		= stepAttacks( sq, knightDirs, 8 );
+		kingAttacks[ sq ]		= stepAttacks( sq, kingDirs, 8 );
+		pawnAttacks[ 0 ][ sq ]	= stepAttacks( sq, pawnDirs[ 0 ], 2 );
+		pawnAttacks[ 1 ][ sq ]	= stepAttacks( sq, pawnDirs[ 1 ], 2 );
+		}
+	initMagics( rookMagics, rookTable, rookDirs );
+	initMagics( bishopMagics, bishopTable, bishopDirs );
+
+	// Lines and the squares between, for every pair of
+	// squares sharing a rank, file or diagonal
+	for( sq = 0; sq < 64; sq++ )
+		{
+		for( to = 0; to < 64; to++ )
+			{
+			if( sq != to && ( rookAttacks( sq, 0 ) & BIT( to ) ) )
+				{
+				lineBB[ sq ][ to ]		= ( rookAttacks( sq, 0 ) & rookAttacks( to, 0 ) ) | BIT( sq ) | BIT( to );
+				betweenBB[ sq ][ to ]	= rookAttacks( sq, BIT( to ) ) & rookAttacks( to, BIT( sq ) );
+				}
+			else if( sq != to && ( bishopAttacks( sq, 0 ) & BIT( to ) ) )
+				{
+				lineBB[ sq ][ to ]		= ( bishopAttacks( sq, 0 ) & bishopAttacks( to, 0 ) ) | BIT( sq ) | BIT( to );
+				betweenBB[ sq ][ to ]	= bishopAttacks( sq, BIT( to ) ) & bishopAttacks( to, BIT( sq ) );
+				}
+			else
+				{
+				lineBB[ sq ][ to ]		= 0;
+				betweenBB[ sq ][ to ]	= 0;
+				}
+			}
+		}
+
+	initialized = true;
+	return;
+	}
@@ -0,0 +1,99 @@
+/**************************************************************
+* attacks.h
+* Declarations for the precomputed chess attack tables
+* CS5400, FS 2016
+* Stuart Miller
+**************************************************************/
+#ifndef JOUEUR_CHESS_ATTACKS_H
+#define JOUEUR_CHESS_ATTACKS_H
+
+/******************************************************
+* Includes
+******************************************************/
+#include "bitboard.h"
+
+
+/******************************************************
+* Compiler Constants
+******************************************************/
+#define ROOK_TABLE_SZ		( 102400 )
+#define BISHOP_TABLE_SZ		( 5248 )
+
+
+/******************************************************
+* Types
+******************************************************/
+// Magic bitboard entry for a single square. Blockers
+// under mask are multiplied by magic and shifted down
+// to form an index into that square's attack slice.
+typedef struct
+	{
+	Bitboard	mask;
+	Bitboard	magic;
+	Bitboard*	attacks;
+	int			shift;
+	} Magic;
+
+
+/******************************************************
+* Attack Tables
+******************************************************/
+extern Magic		rookMagics[ 64 ];
+extern Magic		bishopMagics[ 64 ];
+extern Bitboard		knightAttacks[ 64 ];
+extern Bitboard		kingAttacks[ 64 ];
+extern Bitboard		pawnAttacks[ 2 ][ 64 ];
+
+// Squares strictly between two aligned squares, and the
+// whole line through them. Both are empty for squares
+// that share no rank, file or diagonal.
+extern Bitboard		betweenBB[ 64 ][ 64 ];
+extern Bitboard		lineBB[ 64 ][ 64 ];
+
+
+/******************************************************
+* Function Declarations
+******************************************************/
+void initAttacks();
+
+
+/******************************************************
+* Random Number
+* xorshift64* generator over the passed state. Callers
+* keep their own seed, so each table comes out the same
+* on every run.
+******************************************************/
+inline uint64_t random64( uint64_t& seed )
+	{
+	seed ^= seed >> 12;
+	seed ^= seed << 25;
+	seed ^= seed >> 27;
+	return seed * 0x2545F4914F6CDD1DULL;
+	}
+
+
+/******************************************************
+* Sliding Piece Lookups
+* Returns all squares attacked by a slider on sq,
+* given the occupancy of the whole board. Blocking
+* squares are included, so callers must mask off
+* their own pieces.
+******************************************************/
+inline Bitboard rookAttacks( int sq, Bitboard occ )
+	{
+	const Magic& m = rookMagics[ sq ];
+	return m.attacks[ ( ( occ & m.mask ) * m.magic ) >> m.shift ];
+	}
+
+inline Bitboard bishopAttacks( int sq, Bitboard occ )
+	{
+	const Magic& m = bishopMagics[ sq ];
+	return m.attacks[ ( ( occ & m.mask ) * m.magic ) >> m.shift ];
+	}
+
+inline Bitboard queenAttacks( int sq, Bitboard occ )
+	{
+	return rookAttacks( sq, occ ) | bishopAttacks( sq, occ );
+	}
+
+#endif
@@ -0,0 +1,145 @@
+/**************************************************************
+* bitboard.h
+* Declarations for the chess bitboard type and bit operations
+* CS5400, FS 2016
+* Stuart Miller
+**************************************************************/
+#ifndef JOUEUR_CHESS_BITBOARD_H
+#define JOUEUR_CHESS_BITBOARD_H
+
+/******************************************************
+* Includes
+******************************************************/
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+/******************************************************
+* Compiler Constants
+******************************************************/
+#define FILE_A_BB			( 0x0101010101010101ULL )
+#define FILE_H_BB			( 0x8080808080808080ULL )
+
+
+/******************************************************
+* Types
+******************************************************/
+typedef uint64_t Bitboard;
+
+
+/******************************************************
+* Macros
+******************************************************/
+#define BIT( idx )			( ( Bitboard )1 << ( idx ) )
+
+
+/******************************************************
+* Square Bit
+* Constexpr form of BIT() for use in constant tables
+******************************************************/
+constexpr Bitboard squareBit( int idx )
+	{
+	return ( Bitboard )1 << idx;
+	}
+
+
+/******************************************************
+* Least Significant Bit
+* Index of the lowest set bit. Undefined for bb == 0.
+******************************************************/
+inline int lsb( Bitboard bb )
+	{
+#ifdef _MSC_VER
+	unsigned long idx;
+	_BitScanForward64( &idx, bb );
+	return ( int )idx;
+#else
+	return __builtin_ctzll( bb );
+#endif
+	}
+
+
+/******************************************************
+* Population Count
+* Number of set bits in the bitboard
+******************************************************/
+inline int popCount( Bitboard bb )
+	{
+#ifdef _MSC_VER
+	return ( int )__popcnt64( bb );
+#else
+	return __builtin_popcountll( bb );
+#endif
+	}
+
+
+/******************************************************
+* Pop Least Significant Bit
+* Clears the lowest set bit (compiles to blsr) and
+* returns its index. bb must be non-zero.
+******************************************************/
+inline int popLsb( Bitboard& bb )
+	{
+	int idx = lsb( bb );
+	bb &= bb - 1;
+	return idx;
+	}
+
+
+/******************************************************
+* Forward Bit Scan
+* Returns the index of the first set bit, or -1 if
+* the bitboard is empty
+******************************************************/
+inline int bitScanForward( Bitboard bb )
+	{
+	return( bb ? lsb( bb ) : -1 );
+	}
+
+
+/******************************************************
+* File Fills
+* Smear every set bit up (north) or down (south) its
+* file to the edge of the board, in three shifts. The
+* original bits are kept.
+******************************************************/
+inline Bitboard northFill( Bitboard bb )
+	{
+	bb |= bb << 8;
+	bb |= bb << 16;
+	bb |= bb << 32;
+	return bb;
+	}
+
+inline Bitboard southFill( Bitboard bb )
+	{
+	bb |= bb >> 8;
+	bb |= bb >> 16;
+	bb |= bb >> 32;
+	return bb;
+	}
+
+inline Bitboard fileFill( Bitboard bb )
+	{
+	return northFill( bb ) | southFill( bb );
+	}
+
+
+/******************************************************
+* East / West Shifts
+* Move every bit one file toward h or toward a,
+* dropping bits that would wrap onto the next rank
+******************************************************/
+inline Bitboard shiftEast( Bitboard bb )
+	{
+	return ( bb << 1 ) & ~FILE_A_BB;
+	}
+
+inline Bitboard shiftWest( Bitboard bb )
+	{
+	return ( bb >> 1 ) & ~FILE_H_BB;
+	}
+
+#endif
@@ -33,6 +33,9 @@
  * implementation. To do this supply a macro or function definition
  * here:
  */
+#if defined( __GNUC__ )
+#define TB_CUSTOM_POP_COUNT( x )	( __builtin_popcountll( x ) )
+#else
 #define TB_CUSTOM_POP_COUNT( x )	( popcnt( x ) )
 
 /* Customer Compiler-nonspecific implementation of popcount
@@ -47,13 +50,16 @@ extern inline int popcnt( unsigned long i )
 		}
 	return c;
 	}
+#endif
 
 /*
  * Define TB_CUSTOM_LSB to override the internal lsb
  * implementation. To do this supply a macro or function definition
  * here:
  */
-/* #define TB_CUSTOM_LSB(x) <DEFINITION> */
+#if defined( __GNUC__ )
+#define TB_CUSTOM_LSB( x )			( __builtin_ctzll( x ) )
+#endif
 
 /*
  * Define TB_CUSTOM_BSWAP32 to override the internal bswap32
@@ -29,9 +29,21 @@ int mobPenalty;
 int	movesThreshold;
 int	movesEstimate;
 int	maxDepth;
-int histTableMaxSz;
-int quiescenceDepth;
 int useEndGameTables;
+int ttSizeMb;
+int threads;
+int parallelMode;
+int poolAffinity;
+int nullMoveReduction;
+int nullMoveMinDepth;
+int lmrMinMoves;
+int lmrMinDepth;
+int hangingPenalty;
+int kingAttackersMin;
+int kingZoneRook;
+int kingZoneKnight;
+int kingZoneBishop;
+int kingZoneQueen;
 
 // Definition map
 static std::map<std::string, int*> valConvert = {
@@ -46,9 +58,21 @@ static std::map<std::string, int*> valConvert = {
 		{ "movesthreshold",		&movesThreshold },
 		{ "movesestimate",		&movesEstimate },
 		{ "maxdepth",			&maxDepth },
-		{ "histtablemaxsz",		&histTableMaxSz },
-		{ "quiescencedepth",	&quiescenceDepth },
-		{ "useendgametables",	&useEndGameTables }
+		{ "useendgametables",	&useEndGameTables },
+		{ "ttsizemb",			&ttSizeMb },
+		{ "threads",			&threads },
+		{ "parallelmode",		&parallelMode },
+		{ "poolaffinity",		&poolAffinity },
+		{ "nullmovereduction",	&nullMoveReduction },
+		{ "nullmovemindepth",	&nullMoveMinDepth },
+		{ "lmrminmoves",		&lmrMinMoves },
+		{ "lmrmindepth",		&lmrMinDepth },
+		{ "hangingpenalty",		&hangingPenalty },
+		{ "kingattackersmin",	&kingAttackersMin },
+		{ "kingzonerook",		&kingZoneRook },
+		{ "kingzoneknight",		&kingZoneKnight },
+		{ "kingzonebishop",		&kingZoneBishop },
+		{ "kingzonequeen",		&kingZoneQueen }
 	};
 
 
@@ -97,8 +121,20 @@ void initGlobals()
 	movesThreshold = 40;
 	movesEstimate = 150;
 	maxDepth = 20;
-	histTableMaxSz = 100000;
-	quiescenceDepth = 2;
 	useEndGameTables = 0;
+	ttSizeMb = 64;
+	threads = 1;
+	parallelMode = 0;
+	poolAffinity = 0;
+	nullMoveReduction = 2;
+	nullMoveMinDepth = 3;
+	lmrMinMoves = 3;
+	lmrMinDepth = 3;
+	hangingPenalty = 3;
+	kingAttackersMin = 2;
+	kingZoneRook = 2;
+	kingZoneKnight = 1;
+	kingZoneBishop = 1;
+	kingZoneQueen = 3;
 	initialized = true;
 	}
\ No newline at end of file
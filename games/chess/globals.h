@@ -26,9 +26,21 @@ extern int mobPenalty;
 extern int movesThreshold;
 extern int movesEstimate;
 extern int maxDepth;
-extern int histTableMaxSz;
-extern int quiescenceDepth;
 extern int useEndGameTables;
+extern int ttSizeMb;
+extern int threads;
+extern int parallelMode;
+extern int poolAffinity;
+extern int nullMoveReduction;
+extern int nullMoveMinDepth;
+extern int lmrMinMoves;
+extern int lmrMinDepth;
+extern int hangingPenalty;
+extern int kingAttackersMin;
+extern int kingZoneRook;
+extern int kingZoneKnight;
+extern int kingZoneBishop;
+extern int kingZoneQueen;
 
 
 /******************************************************
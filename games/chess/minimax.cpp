@@ -14,10 +14,15 @@
 #include "state.h"
 #include "minimax.h"
 #include "globals.h"
+#include "ttable.h"
+#include "threadpool.h"
 #include <algorithm>
 #include <chrono>
 #include <time.h>
 #include <unordered_map>
+#include <atomic>
+#include <cstring>
+#include <memory>
 
 
 /******************************************************
@@ -26,30 +31,81 @@
 #define MAX( x, y )		( ( x ) > ( y ) ? ( x ) : ( y ) )
 #define MIN( x, y )		( ( x ) < ( y ) ? ( x ) : ( y ) )
 #define GET_TIME_MS()	( (unsigned long long )( std::chrono::duration_cast< std::chrono::milliseconds >( std::chrono::system_clock::now().time_since_epoch()).count() ) )
+#define SEARCHING()		( !stopSearch && GET_TIME_MS() < endTime )
+
+// Mate scores count plies from the root. The table keeps
+// them counted from the node they were stored at, so they
+// stay right when the node is reached at another ply.
+#define IS_MATE( s )			( ( s ) >= MATE_BOUND || ( s ) <= -MATE_BOUND )
+#define SCORE_TO_TT( s, ply )	( ( s ) >= MATE_BOUND ? ( s ) + ( ply ) : ( ( s ) <= -MATE_BOUND ? ( s ) - ( ply ) : ( s ) ) )
+#define SCORE_FROM_TT( s, ply )	( ( s ) >= MATE_BOUND ? ( s ) - ( ply ) : ( ( s ) <= -MATE_BOUND ? ( s ) + ( ply ) : ( s ) ) )
 
 
 /******************************************************
 * Variables
 ******************************************************/
-static int			pruned;
-static int			expanded;
-static int			expandedNQ;
-static int			depth;
 unsigned long long 	endTime;
 static int			moves = 0;
-std::unordered_map<Chess::State, int, StateHash> 
-					historyTable;
+// Ply of the position being searched, so that nodes know
+// how far they are from it
+static int			rootPly = 0;
+static std::atomic<bool>
+					stopSearch( false );
+static std::vector<SearchContext>
+					contexts;
+static std::vector<SearchTables>
+					contextTables;
+// Capture ordering rank of each piece type, indexed by
+// PieceType. NO_PIECE ranks zero for non-captures.
+static const int	mvvLvaRank[ 7 ] = { 1, 4, 2, 3, 5, 6, 0 };
+// Move ordering tables used by split point tasks run on
+// this thread
+static thread_local SearchTables
+					threadTables;
+// Contexts for split point tasks run on this thread, one
+// per level of task nesting, kept for later tasks
+static thread_local std::vector<std::unique_ptr<SearchContext>>
+					taskContexts;
+static thread_local int
+					taskNesting = 0;
+
+
+/******************************************************
+* Local Function Declarations
+******************************************************/
+static void helperSearch( SearchContext* ctx );
+static void minimax( SearchContext* ctx, int depth, Action* bestAction );
+static int pvs( SearchContext* ctx, int alpha, int beta, int depth, bool first, int reduction );
+static int negamax( SearchContext* ctx, int alpha, int beta, int depth, Action* bestAction );
+static int lateMoveReduction( ScoredAction* runner, int index, int depth, bool inCheck );
+static int quiesce( SearchContext* ctx, int alpha, int beta );
+static void splitSearch( SearchContext* ctx, ScoredAction* first, ScoredAction* last, int index, bool inCheck, int& alpha, int beta, int depth, int& bestVal, ScoredAction*& bestAction );
+static void searchSibling( SearchContext* parent, SplitPoint* sp, ScoredAction* action, int depth, int reduction );
+static bool searching( SearchContext* ctx );
+static SearchTables* threadSearchTables();
 
 
 /******************************************************
 * Return Statistics
+* Node counts are summed over every search thread, the
+* depth is the one reached by the main thread
 ******************************************************/
 void getStats( int& p, int& e, int& enq, int& d )
 	{
-	p = pruned;
-	e = expanded;
-	enq = expandedNQ;
-	d = depth;
+	p = 0;
+	e = 0;
+	enq = 0;
+	d = 0;
+	for( size_t i = 0; i < contexts.size(); i++ )
+		{
+		p += contexts[ i ].pruned;
+		e += contexts[ i ].expanded;
+		enq += contexts[ i ].expandedNQ;
+		}
+	if( !contexts.empty() )
+		{
+		d = contexts[ 0 ].depth;
+		}
 	return;
 	}
 
@@ -58,14 +114,15 @@ void getStats( int& p, int& e, int& enq, int& d )
 * Iterative Deepening Minimax Root Call
 * time is given in ns
 ******************************************************/
-void id_minimax( Chess::State* root, Chess::State* bestAction, double time )
+void id_minimax( Chess::State* root, Action* bestAction, double time )
 	{
+	int numThreads = ( parallelMode == PARALLEL_YBWC ? 1 : pool.size() + 1 );
+	int i;
 
 	// Update vars
 	moves++;
-	pruned		= 0;
-	expanded	= 0;
-	expandedNQ	= 0;
+	rootPly = root->ply;
+	tt.newSearch();
 
 	// Calculate allowed time
 	if( moves > ( movesEstimate - movesThreshold ) )
@@ -74,14 +131,54 @@ void id_minimax( Chess::State* root, Chess::State* bestAction, double time )
 		}
 	endTime = GET_TIME_MS() + ( time / NS_PER_MS / movesEstimate );
 
+	// Give every thread its own copy of the root. History
+	// is aged and countermoves kept from turn to turn,
+	// killers are cleared. In YBWC mode the pool works
+	// under the main thread's context instead.
+	contexts.resize( numThreads );
+	contextTables.resize( numThreads );
+	for( i = 0; i < numThreads; i++ )
+		{
+		contexts[ i ].id			= i;
+		contexts[ i ].state.copyFrom( *root );
+		contexts[ i ].tables		= &contextTables[ i ];
+		contexts[ i ].split			= nullptr;
+		contexts[ i ].pruned		= 0;
+		contexts[ i ].expanded		= 0;
+		contexts[ i ].expandedNQ	= 0;
+		contexts[ i ].depth			= 0;
+		contexts[ i ].score			= -INFINITE_SCORE;
+		memset( contextTables[ i ].refutations.killers, 0, sizeof( contextTables[ i ].refutations.killers ) );
+		ageHistory( &contextTables[ i ].history );
+		}
+
+	// Start from the move the root picker would try first,
+	// so that there is a legal move to play even if depth 1
+	// runs out of time
+	TTEntry ttEntry;
+	Action ttAction = ( tt.probe( root->key, ttEntry ) ? ttEntry.action : NULL_ACTION );
+	MovePicker rootPicker( &contexts[ 0 ].state, ttAction, &contextTables[ 0 ].history, &contextTables[ 0 ].refutations );
+	ScoredAction* firstAction = rootPicker.next();
+	*bestAction = ( firstAction != nullptr ? firstAction->action : NULL_ACTION );
+
+	// Start Lazy SMP helpers on the pool. They only feed the
+	// transposition table.
+	TaskGroup helpers;
+	stopSearch = false;
+	for( i = 1; i < numThreads; i++ )
+		{
+		SearchContext* helper = &contexts[ i ];
+		pool.submit( helpers, [ helper ]() { helperSearch( helper ); } );
+		}
+
 	// Iteratively call minimax
-	int toIdx, fromIdx;
-	Chess::State fallbackAction;
-	for( depth = 1; depth < maxDepth; depth++ )
+	SearchContext& ctx = contexts[ 0 ];
+	Action fallbackAction;
+	for( ctx.depth = 1; ctx.depth < maxDepth; ctx.depth++ )
 		{
 		fallbackAction = *bestAction;
-		std::cout << "  Depth " << depth << ": ";
-		minimax( root, depth, quiescenceDepth, bestAction );
+		std::cout << "  Depth " << ctx.depth << ": ";
+		minimax( &ctx, ctx.depth, bestAction );
 		if( GET_TIME_MS() > ( endTime - TIME_TOLERANCE ) )
 			{
 			*bestAction = fallbackAction;
@@ -90,158 +187,561 @@ void id_minimax( Chess::State* root, Chess::State* bestAction, double time )
 			}
 		else
 			{
-			toIdx = ( bestAction->misc.to_ullong() & TOIDX_MASK ) >> TOIDX_BITSHIFT;
-			fromIdx = ( bestAction->misc.to_ullong() & FROMIDX_MASK ) >> FROMIDX_BITSHIFT;
-			std::cout << "Chose " << ( char )( ( fromIdx % 8 ) + 'a' ) << ( fromIdx / 8 ) + 1 << " to " << ( char )( ( toIdx % 8 ) + 'a' ) << ( toIdx / 8 ) + 1 << std::endl;
+			std::cout << "Chose " << actionToString( *bestAction ) << std::endl;
 			}
 		}
+
+	// Stop helpers
+	stopSearch = true;
+	pool.wait( helpers );
+	return;
+	}
+
+
+/******************************************************
+* Helper Search
+* Lazy SMP helper thread. Runs its own iterative
+* deepening loop on the same root, with every other
+* helper one ply ahead of the main thread, so that the
+* threads spread out over the tree and share their
+* results through the transposition table.
+******************************************************/
+static void helperSearch( SearchContext* ctx )
+	{
+	Action action = NULL_ACTION;
+	for( ctx->depth = 1 + ( ctx->id % 2 ); ctx->depth < maxDepth && searching( ctx ); ctx->depth++ )
+		{
+		minimax( ctx, ctx->depth, &action );
+		}
 	return;
 	}
 
 
 /******************************************************
 * Minimax Root Call
+* Searches an aspiration window centered on the score
+* of the previous iteration, widening whichever side
+* fails until the score lands inside it. The best
+* action is only returned from a search that did.
 ******************************************************/
-static void minimax( Chess::State* root, int depth, int qDepth, Chess::State* bestAction )
+static void minimax( SearchContext* ctx, int depth, Action* bestAction )
 	{
-	minMaxVal( root, INT_MIN, INT_MAX, depth, qDepth, MAX, bestAction );
+	int alpha = -INFINITE_SCORE;
+	int beta = INFINITE_SCORE;
+	int delta = ASPIRATION_DELTA;
+	int val;
+	Action action = NULL_ACTION;
+
+	if( depth >= ASPIRATION_MIN_DEPTH && !IS_MATE( ctx->score ) )
+		{
+		alpha = ctx->score - delta;
+		beta = ctx->score + delta;
+		}
+
+	while( true )
+		{
+		val = negamax( ctx, alpha, beta, depth, &action );
+		if( !searching( ctx ) )
+			{
+			return;
+			}
+		delta *= 2;
+		if( val <= alpha && alpha != -INFINITE_SCORE )
+			{
+			alpha = ( delta > ASPIRATION_MAX_DELTA ? -INFINITE_SCORE : alpha - delta );
+			}
+		else if( val >= beta && beta != INFINITE_SCORE )
+			{
+			beta = ( delta > ASPIRATION_MAX_DELTA ? INFINITE_SCORE : beta + delta );
+			}
+		else
+			{
+			break;
+			}
+		}
+
+	ctx->score = val;
+	*bestAction = action;
 	return;
 	}
 
 
+/******************************************************
+* Principal Variation Search
+* Searches the child reached by the last move, from the
+* parent's point of view. Every child but the first is
+* expected to be worse than the best so far, so it is
+* scouted with a null window and only searched again
+* with the full window if it proves otherwise. A
+* non-zero reduction adds a shallower scout before that.
+******************************************************/
+static int pvs( SearchContext* ctx, int alpha, int beta, int depth, bool first, int reduction )
+	{
+	int val;
+	if( first )
+		{
+		return -negamax( ctx, -beta, -alpha, depth, nullptr );
+		}
+
+	// Late moves are scouted at reduced depth first, and
+	// dropped if they can't even beat alpha there
+	if( reduction > 0 )
+		{
+		val = -negamax( ctx, -alpha - 1, -alpha, depth - reduction, nullptr );
+		if( val <= alpha )
+			{
+			return val;
+			}
+		}
+	val = -negamax( ctx, -alpha - 1, -alpha, depth, nullptr );
+	if( val > alpha && val < beta )
+		{
+		val = -negamax( ctx, -beta, -alpha, depth, nullptr );
+		}
+	return val;
+	}
+
+
 /******************************************************
-* MaxVal
-* Returns the maximum value of the passed state's children
-* If the passed state pointer is non-null, it will also
-* return a pointer to the maximum valued state
+* Negamax
+* Returns the value of the passed state for the side to
+* move. If the passed action pointer is non-null, it
+* will also return the best action.
 ******************************************************/
-static int minMaxVal( Chess::State* state, int alpha, int beta, int depth, int qDepth, MinMax m, Chess::State* returnAction )
+static int negamax( SearchContext* ctx, int alpha, int beta, int depth, Action* returnAction )
 	{
-	// Check depth limits
+	Chess::State*				state = &ctx->state;
+	int							ttDepth = depth;
+	int							ttScore;
+	int							height = state->ply - rootPly;
+	int							alphaOrig = alpha;
+	Action						ttAction = NULL_ACTION;
+	TTEntry						ttEntry;
+
+	// Check depth limits. The undo stack and killer table
+	// run out at MAX_PLY, whatever depth is left.
 	if( depth == 0 )
 		{
-		if( qDepth == 0 || !state->isNonQuiescent() )
-			{
-			return state->score;
-			}
-		else
-			{
-			expandedNQ++;
-			qDepth--;
-			}
+		return quiesce( ctx, alpha, beta );
 		}
-	else
+	if( returnAction == nullptr && state->ply >= MAX_PLY - 1 )
 		{
-		depth--;
+		return state->evaluate();
+		}
+	depth--;
+
+	// Check transposition table. The root always searches
+	// to find a move.
+	if( tt.probe( state->key, ttEntry ) )
+		{
+		ttAction = ttEntry.action;
+		ttScore = SCORE_FROM_TT( ttEntry.score, height );
+		if( returnAction == nullptr && ttEntry.depth >= ttDepth )
+			{
+			if( ttEntry.bound == BOUND_EXACT ||
+				( ttEntry.bound == BOUND_LOWER && ttScore >= beta ) ||
+				( ttEntry.bound == BOUND_UPPER && ttScore <= alpha ) )
+				{
+				return ttScore;
+				}
+			}
 		}
 
 	// Declarations
-	std::vector<Chess::State*>	frontier;
+	ActionList					siblings;
 	int							val;
-	int							bestVal = ( m == MIN ? INT_MAX : INT_MIN );
-	Chess::State*				bestAction;
-	std::vector<Chess::State*>::iterator 
-								runner;
+	int							bestVal = -INFINITE_SCORE;
+	int							index;
+	int							reduction;
+	int							bonus;
+	int							i;
+	int							numQuiets = 0;
+	Action						quiets[ MAX_ACTIONS ];
+	bool						inCheck = state->inCheck();
+	ScoredAction*				bestAction;
+	ScoredAction*				runner;
+	bool						canSplit;
+	bool						quiet;
+
+	// Null move pruning. If passing the turn still fails
+	// high, a real move almost certainly would too. Not
+	// tried in check, twice in a row, or with only pawns
+	// left, where zugzwang makes passing look too good.
+	if( nullMoveReduction > 0 && returnAction == nullptr && ttDepth >= nullMoveMinDepth && !inCheck &&
+		beta < MATE_BOUND && state->ply > 0 && state->undoStack[ state->ply - 1 ].action != NULL_ACTION &&
+		state->hasNonPawnMaterial( state->turn ) && state->evaluate() >= beta )
+		{
+		state->makeNullMove();
+		val = -negamax( ctx, -beta, -beta + 1, MAX( depth - nullMoveReduction, 0 ), nullptr );
+		state->unmakeNullMove();
+		if( val >= beta && searching( ctx ) )
+			{
+			ctx->pruned++;
+			return( val >= MATE_BOUND ? beta : val );
+			}
+		}
 
-	// Build frontier
-	state->Actions( frontier, ( m == MIN ? OPPONENT : ME ) );
-	expanded++;
+	// Moves come from the picker in order, and later
+	// stages are only generated if they are reached
+	MovePicker picker( state, ttAction, &ctx->tables->history, &ctx->tables->refutations );
+	ctx->expanded++;
 
-	if( frontier.size() == 0 )
+	// No moves is checkmate in check, and stalemate, a
+	// draw, otherwise. Nearer mates score further from
+	// zero, so the search goes for the quickest one.
+	if( ( runner = picker.next() ) == nullptr )
 		{
-		return( m == MIN ? INT_MAX : INT_MIN );
-		}		
+		return( inCheck ? -MATE_SCORE + height : 0 );
+		}
 
-	// Read history table and sort accordingly
-	for( runner = frontier.begin(); runner != frontier.end(); runner++ )
+	// Evaluate each action in turn. In YBWC mode the
+	// eldest child is searched alone, then its siblings
+	// are handed to the thread pool.
+	bestAction = runner;
+	canSplit = ( parallelMode == PARALLEL_YBWC && pool.size() > 0 && depth >= SPLIT_MIN_DEPTH );
+	for( index = 0; runner != nullptr && searching( ctx ); runner = picker.next(), index++ )
 		{
-		if( historyTable.find( *runner ) == historyTable.end() )
+		reduction = lateMoveReduction( runner, index, depth, inCheck );
+		state->makeMove( runner->action );
+		val = pvs( ctx, alpha, beta, depth, index == 0, reduction );
+		state->unmakeMove();
+
+		// Update values if better state found
+		if( val > bestVal )
 			{
-			( *runner )->setHistoryVal( 0 );
+			bestVal = val;
+			bestAction = runner;
 			}
-		else
+		alpha = MAX( val, alpha );
+
+		// Prune if fail-high. A quiet move that did it is
+		// remembered, and the quiet moves tried before it
+		// lose history.
+		quiet = ( !IS_CAPTURE( runner->action ) && !IS_PROMOTION( runner->action ) );
+		if( val >= beta )
 			{
-			( *runner )->setHistoryVal( historyTable[ *runner ] );
+			if( quiet )
+				{
+				bonus = ttDepth * ttDepth * 4;
+				storeRefutation( &ctx->tables->refutations, state, runner->action );
+				updateHistory( &ctx->tables->history, state->sideColor( state->turn ), runner->action, bonus );
+				for( i = 0; i < numQuiets; i++ )
+					{
+					updateHistory( &ctx->tables->history, state->sideColor( state->turn ), quiets[ i ], -bonus );
+					}
+				}
+			ctx->pruned++;
+			break;
 			}
-		}
-	std::sort( frontier.begin(), frontier.end(), StateSort() );
-
-	// Evaluate each state in frontier
-	bestAction = frontier.front();
-	if( m == MIN )
-		{
-		for( runner = frontier.begin(); runner != frontier.end() && GET_TIME_MS() < endTime; runner++ )
+		if( quiet )
 			{
-			val = minMaxVal( *runner, alpha, beta, depth, qDepth, MAX, nullptr );
-			( *runner )->score = val;
+			quiets[ numQuiets++ ] = runner->action;
+			}
 
-			// Update values if better state found
-			if( val < bestVal )
+		// Young brothers wait. The siblings are all
+		// generated now, since the tasks need a fixed list.
+		// Their scores are kept for the reductions.
+		if( canSplit )
+			{
+			while( ( runner = picker.next() ) != nullptr )
 				{
-				bestVal = val;
-				bestAction = ( *runner );
+				siblings.push( runner->action );
+				siblings[ siblings.size - 1 ].score = runner->score;
 				}
-			beta = MIN( val, beta );
-
-			// Prune if fail-low
-			if( val <= alpha )
+			if( siblings.size > 0 )
 				{
-				pruned++;
-				break;
+				splitSearch( ctx, siblings.begin(), siblings.end(), index + 1, inCheck, alpha, beta, depth, bestVal, bestAction );
 				}
+			break;
 			}
 		}
 
-	else // ( m == MAX )
+	// Store result, unless the search was cut short by time
+	if( searching( ctx ) )
 		{
-		for( runner = frontier.begin(); runner != frontier.end() && GET_TIME_MS() < endTime; runner++ )
-			{
-			val = minMaxVal( *runner, alpha, beta, depth, qDepth, MIN, nullptr );
+		tt.store( state->key, bestAction->action, SCORE_TO_TT( bestVal, height ), ttDepth,
+				  bestVal <= alphaOrig ? BOUND_UPPER : ( bestVal >= beta ? BOUND_LOWER : BOUND_EXACT ) );
+		}
 
-			// Update values if better state found
-			if( val > bestVal )
-				{
-				bestVal = val;
-				bestAction = ( *runner );
-				}
-			alpha = MAX( val, alpha );
+	// Return action if root call
+	if( returnAction != nullptr )
+		{
+		*returnAction = bestAction->action;
+		}
 
-			// Prune if fail-high
-			if( val >= beta )
-				{
-				pruned++;
-				break;
-				}
-			}
+	// Return value
+	return bestVal;
+	}
+
+
+/******************************************************
+* Late Move Reduction
+* Plies to take off the scout of the index'th move at a
+* node with depth plies left below it. Only quiet moves
+* ordered far down the list are reduced, and moves with
+* a history score are reduced less.
+******************************************************/
+static int lateMoveReduction( ScoredAction* runner, int index, int depth, bool inCheck )
+	{
+	int reduction = 0;
+	if( lmrMinMoves > 0 && depth + 1 >= lmrMinDepth && index >= lmrMinMoves && !inCheck &&
+		!IS_CAPTURE( runner->action ) && !IS_PROMOTION( runner->action ) )
+		{
+		reduction = ( index >= lmrMinMoves * 2 ? 2 : 1 ) - ( runner->score > 0 ? 1 : 0 );
+		reduction = MIN( reduction, depth - 1 );
 		}
+	return reduction;
+	}
+
+
+/******************************************************
+* Quiescence Search
+* Searches only captures and promotions below the
+* nominal depth, so that the static evaluation is never
+* taken in the middle of an exchange. The side to move
+* may stand pat on the evaluation instead of capturing.
+* In check there is no standing pat, and every evasion
+* is searched.
+******************************************************/
+static int quiesce( SearchContext* ctx, int alpha, int beta )
+	{
+	Chess::State*	state = &ctx->state;
+	ActionList		frontier;
+	ScoredAction*	runner;
+	int				val;
+	int				bestVal;
+	bool			inCheck;
 
-	// Update history table
-	if( historyTable.find( *bestAction ) == historyTable.end() )
+	// Nothing deeper fits on the undo stack
+	ctx->expandedNQ++;
+	if( state->ply >= MAX_PLY - 1 )
 		{
-		if( historyTable.size() >= histTableMaxSz )
+		return state->evaluate();
+		}
+	inCheck = state->inCheck();
+
+	if( inCheck )
+		{
+		state->Actions( frontier );
+		if( frontier.size == 0 )
 			{
-			historyTable.erase( historyTable.begin() );
+			return -MATE_SCORE + ( state->ply - rootPly );
 			}
-		historyTable[ bestAction ] = 0;
+		bestVal = -INFINITE_SCORE;
 		}
 	else
 		{
-		historyTable[ *bestAction ] += 1;
+		// Stand pat
+		bestVal = state->evaluate();
+		if( bestVal >= beta )
+			{
+			return bestVal;
+			}
+		alpha = MAX( alpha, bestVal );
+		state->Captures( frontier );
 		}
 
-	// Free memory (and return if root call)
-	for( int i = 0; i < frontier.size(); i++ )
+	// Most valuable victim, least valuable attacker
+	for( runner = frontier.begin(); runner != frontier.end(); runner++ )
 		{
-		if( returnAction != nullptr && frontier[ i ] == bestAction )
+		runner->score = mvvLvaRank[ ACTION_CAPTURED( runner->action ) ] * 8 - mvvLvaRank[ ACTION_PIECE( runner->action ) ];
+		if( IS_PROMOTION( runner->action ) )
 			{
-			*returnAction = *bestAction;
+			runner->score += mvvLvaRank[ PROMOTION_PIECE( runner->action ) ] * 8;
 			}
-		else
+		}
+	std::sort( frontier.begin(), frontier.end(), ActionSort() );
+
+	for( runner = frontier.begin(); runner != frontier.end() && searching( ctx ); runner++ )
+		{
+		// Captures that lose material can't raise the score
+		// above standing pat
+		if( !inCheck && state->see( runner->action ) < 0 )
 			{
-			delete frontier[ i ];
+			continue;
+			}
+
+		state->makeMove( runner->action );
+		val = -quiesce( ctx, -beta, -alpha );
+		state->unmakeMove();
+
+		if( val > bestVal )
+			{
+			bestVal = val;
+			}
+		alpha = MAX( val, alpha );
+		if( val >= beta )
+			{
+			ctx->pruned++;
+			break;
 			}
 		}
 
-	// Return value
 	return bestVal;
 	}
+
+
+/******************************************************
+* Split Search
+* Searches every action from first up to last in
+* parallel, sharing one window between them. first is
+* the index'th move of the node, and each action is
+* reduced as if searched in order. Returns once all
+* have finished or one of them caused a cutoff, with
+* the window and best result updated.
+******************************************************/
+static void splitSearch( SearchContext* ctx, ScoredAction* first, ScoredAction* last, int index, bool inCheck, int& alpha, int beta, int depth, int& bestVal, ScoredAction*& bestAction )
+	{
+	SplitPoint		sp;
+	TaskGroup		group;
+	ScoredAction*	runner;
+	int				reduction;
+
+	sp.parent		= ctx->split;
+	sp.cutoff		= false;
+	sp.alpha		= alpha;
+	sp.beta			= beta;
+	sp.bestVal		= bestVal;
+	sp.bestAction	= bestAction;
+	sp.pruned		= 0;
+	sp.expanded		= 0;
+	sp.expandedNQ	= 0;
+
+	for( runner = first; runner != last; runner++, index++ )
+		{
+		reduction = lateMoveReduction( runner, index, depth, inCheck );
+		pool.submit( group, [ ctx, &sp, runner, depth, reduction ]() { searchSibling( ctx, &sp, runner, depth, reduction ); } );
+		}
+	pool.wait( group );
+
+	alpha		= sp.alpha;
+	bestVal		= sp.bestVal;
+	bestAction	= sp.bestAction;
+	ctx->pruned		+= sp.pruned + ( sp.cutoff ? 1 : 0 );
+	ctx->expanded	+= sp.expanded;
+	ctx->expandedNQ	+= sp.expandedNQ;
+	return;
+	}
+
+
+/******************************************************
+* Search Sibling
+* Thread pool task for one child of a split point. The
+* parent's state is left untouched while it waits, so
+* it can be copied here. Tasks nest on the stacks of
+* threads waiting on their own split points, so the
+* child's context is never put on the stack. Each
+* thread keeps one on the heap per level of nesting,
+* and only the board and live undo entries are copied
+* into it.
+******************************************************/
+static void searchSibling( SearchContext* parent, SplitPoint* sp, ScoredAction* action, int depth, int reduction )
+	{
+	SearchContext*	child;
+	int				alpha, beta, val;
+
+	// Pick up the current window, unless a sibling already
+	// made this child irrelevant
+		{
+		std::lock_guard<std::mutex> guard( sp->lock );
+		if( sp->cutoff )
+			{
+			return;
+			}
+		alpha	= sp->alpha;
+		beta	= sp->beta;
+		}
+
+	// Nested tasks only run inside pvs(), so the context
+	// is free for reuse again once it returns
+	if( taskNesting == ( int )taskContexts.size() )
+		{
+		taskContexts.emplace_back( new SearchContext );
+		}
+	child = taskContexts[ taskNesting ].get();
+
+	child->id			= parent->id;
+	child->state.copyFrom( parent->state );
+	child->tables		= threadSearchTables();
+	child->split		= sp;
+	child->pruned		= 0;
+	child->expanded		= 0;
+	child->expandedNQ	= 0;
+	child->depth		= 0;
+	child->score		= -INFINITE_SCORE;
+
+	taskNesting++;
+	child->state.makeMove( action->action );
+	val = pvs( child, alpha, beta, depth, false, reduction );
+	child->state.unmakeMove();
+	taskNesting--;
+
+	std::lock_guard<std::mutex> guard( sp->lock );
+	sp->pruned		+= child->pruned;
+	sp->expanded	+= child->expanded;
+	sp->expandedNQ	+= child->expandedNQ;
+	if( !searching( child ) )
+		{
+		return;
+		}
+
+	// Update values if better state found, and prune
+	if( val > sp->bestVal )
+		{
+		sp->bestVal		= val;
+		sp->bestAction	= action;
+		}
+	sp->alpha = MAX( val, sp->alpha );
+	if( val >= sp->beta )
+		{
+		sp->cutoff = true;
+
+		// A quiet move that did it is remembered by this
+		// thread, as it would be by the serial search
+		if( !IS_CAPTURE( action->action ) && !IS_PROMOTION( action->action ) )
+			{
+			storeRefutation( &child->tables->refutations, &child->state, action->action );
+			updateHistory( &child->tables->history, child->state.sideColor( child->state.turn ), action->action, ( depth + 1 ) * ( depth + 1 ) * 4 );
+			}
+		}
+	return;
+	}
+
+
+/******************************************************
+* Thread Search Tables
+* Returns the move ordering tables of the calling
+* thread, for split point tasks. Tables left over from
+* an earlier turn are reset on their first use in this
+* one, the same way id_minimax() resets the contexts'.
+******************************************************/
+static SearchTables* threadSearchTables()
+	{
+	if( threadTables.search != moves )
+		{
+		memset( threadTables.refutations.killers, 0, sizeof( threadTables.refutations.killers ) );
+		ageHistory( &threadTables.history );
+		threadTables.search = moves;
+		}
+	return &threadTables;
+	}
+
+
+/******************************************************
+* Searching
+* False once time is up, the search has been stopped,
+* or any split point above ctx has been cut off
+******************************************************/
+static bool searching( SearchContext* ctx )
+	{
+	if( !SEARCHING() )
+		{
+		return false;
+		}
+	for( SplitPoint* sp = ctx->split; sp != nullptr; sp = sp->parent )
+		{
+		if( sp->cutoff )
+			return false;
+		}
+	return true;
+	}
@@ -11,27 +11,80 @@
 * Includes
 ******************************************************/
 #include "chess.h"
+#include "state.h"
+#include "movepicker.h"
+#include <mutex>
+#include <atomic>
 
 
 /******************************************************
 * Compiler Constants
 ******************************************************/
-#define NS_PER_MS			( 1000000 )
-#define TIME_TOLERANCE		( 10 )
+#define NS_PER_MS				( 1000000 )
+#define TIME_TOLERANCE			( 10 )
+#define SPLIT_MIN_DEPTH			( 2 )
+#define ASPIRATION_MIN_DEPTH	( 4 )
+#define ASPIRATION_DELTA		( 15 )
+#define ASPIRATION_MAX_DELTA	( 500 )
+#define PARALLEL_LAZY_SMP		( 0 )
+#define PARALLEL_YBWC			( 1 )
+#define INFINITE_SCORE			( 1000000 )
+#define MATE_SCORE				( 900000 )
+#define MATE_BOUND				( MATE_SCORE - MAX_PLY )
 
 
 /******************************************************
 * Types
 ******************************************************/
-typedef enum { MIN, MAX } MinMax;
+// A node whose younger children are being searched in
+// parallel. Its window and best result are shared by
+// every task working under it.
+typedef struct SplitPoint
+	{
+	std::mutex			lock;
+	SplitPoint*			parent;
+	std::atomic<bool>	cutoff;
+	int					alpha;
+	int					beta;
+	int					bestVal;
+	ScoredAction*		bestAction;
+	int					pruned;
+	int					expanded;
+	int					expandedNQ;
+	} SplitPoint;
+
+// Move ordering tables learned by one search thread,
+// and the search they were last reset for
+typedef struct
+	{
+	HistoryTable		history;
+	RefutationTable		refutations;
+	int					search;
+	} SearchTables;
+
+// Everything one search thread writes to. Each thread
+// searches its own copy of the root state. Split point
+// tasks get a fresh context, sharing the tables of
+// whichever thread runs them, so the tables are kept
+// out of the context itself.
+typedef struct
+	{
+	int					id;
+	Chess::State		state;
+	SearchTables*		tables;
+	SplitPoint*			split;
+	int					pruned;
+	int					expanded;
+	int					expandedNQ;
+	int					depth;
+	int					score;
+	} SearchContext;
 
 
 /******************************************************
 * Definitions
 ******************************************************/
 void getStats( int& p, int& e, int& enq, int & d );
-void id_minimax( Chess::State* root, Chess::State* bestAction, double time );
-static void minimax( Chess::State* root, int depth, int qDepth, Chess::State* bestAction );
-static int minMaxVal( Chess::State * state, int alpha, int beta, int depth, int qDepth, MinMax m, Chess::State * bestAction );
+void id_minimax( Chess::State* root, Action* bestAction, double time );
 
 #endif
\ No newline at end of file
@@ -0,0 +1,247 @@
+/**************************************************************
+* movepicker.cpp
+* Definitions for the chess staged move picker
+* CS5400, FS 2016
+* Stuart Miller
+**************************************************************/
+
+
+/******************************************************
+* Includes
+******************************************************/
+#include "movepicker.h"
+#include <algorithm>
+#include <cstdlib>
+
+
+/******************************************************
+* Constructor
+* The transposition table move is only played if it is
+* valid here, since a key collision can hand back a
+* move from another position
+******************************************************/
+MovePicker::MovePicker( Chess::State* state, Action ttAction, HistoryTable* history, RefutationTable* refutations )
+	{
+	Action	candidates[ KILLER_SLOTS + 1 ];
+	Action	previous;
+	int		i, j;
+
+	this->state		= state;
+	this->history	= history;
+	stage			= PICK_TT_MOVE;
+	ttMove.action	= ( state->isValid( ttAction ) ? ttAction : NULL_ACTION );
+	ttMove.score	= 0;
+	runner			= nullptr;
+	last			= nullptr;
+	badCaptures		= nullptr;
+	badEnd			= nullptr;
+
+	// Killers for this ply, then the countermove to the
+	// move that led here. Duplicates are dropped here, and
+	// anything not playable is dropped when it is reached.
+	for( i = 0; i < KILLER_SLOTS; i++ )
+		{
+		candidates[ i ] = refutations->killers[ state->ply ][ i ];
+		}
+	previous = ( state->ply > 0 ? state->undoStack[ state->ply - 1 ].action : NULL_ACTION );
+	candidates[ KILLER_SLOTS ] = ( previous == NULL_ACTION ? NULL_ACTION :
+								   refutations->counterMoves[ ACTION_FROM( previous ) ][ ACTION_TO( previous ) ] );
+	numRefutes = 0;
+	for( i = 0; i < KILLER_SLOTS + 1; i++ )
+		{
+		if( candidates[ i ] == NULL_ACTION || candidates[ i ] == ttMove.action )
+			continue;
+		for( j = 0; j < numRefutes && refutes[ j ].action != candidates[ i ]; j++ );
+		if( j == numRefutes )
+			{
+			refutes[ numRefutes ].action = candidates[ i ];
+			refutes[ numRefutes ].score = 0;
+			numRefutes++;
+			}
+		}
+	}
+
+
+/******************************************************
+* Is Refutation
+* True if action was already handed out by the killer
+* stage
+******************************************************/
+bool MovePicker::isRefute( Action action ) const
+	{
+	for( int i = 0; i < numRefutes; i++ )
+		{
+		if( refutes[ i ].action == action )
+			return true;
+		}
+	return false;
+	}
+
+
+/******************************************************
+* Next Move
+* Returns the next move to search, or nullptr once the
+* node has none left. Captures are ordered by static
+* exchange value and those that lose material wait
+* until after the quiet moves. Killers and the
+* countermove come ahead of the other quiet moves,
+* which are ordered by history.
+******************************************************/
+ScoredAction* MovePicker::next()
+	{
+	int side = state->sideColor( state->turn );
+
+	switch( stage )
+		{
+		case PICK_TT_MOVE:
+			stage = PICK_GEN_CAPTURES;
+			if( ttMove.action != NULL_ACTION )
+				{
+				return &ttMove;
+				}
+			// Fall through
+
+		case PICK_GEN_CAPTURES:
+			state->Captures( moves );
+			for( runner = moves.begin(); runner != moves.end(); runner++ )
+				{
+				runner->score = state->see( runner->action );
+				}
+			std::sort( moves.begin(), moves.end(), ActionSort() );
+			runner = moves.begin();
+			last = moves.end();
+			stage = PICK_GOOD_CAPTURES;
+			// Fall through
+
+		case PICK_GOOD_CAPTURES:
+			for( ; runner != last && runner->score >= 0; runner++ )
+				{
+				if( runner->action != ttMove.action )
+					{
+					return runner++;
+					}
+				}
+			badCaptures = runner;
+			badEnd = last;
+			stage = PICK_KILLERS;
+			runner = refutes;
+			// Fall through
+
+		case PICK_KILLERS:
+			for( ; runner != refutes + numRefutes; runner++ )
+				{
+				if( state->isValid( runner->action ) )
+					{
+					return runner++;
+					}
+				}
+			stage = PICK_GEN_QUIETS;
+			// Fall through
+
+		case PICK_GEN_QUIETS:
+			runner = moves.end();
+			state->Quiets( moves );
+			for( last = runner; last != moves.end(); last++ )
+				{
+				last->score = history->scores[ side ][ ACTION_FROM( last->action ) ][ ACTION_TO( last->action ) ];
+				}
+			std::sort( runner, last, ActionSort() );
+			stage = PICK_QUIETS;
+			// Fall through
+
+		case PICK_QUIETS:
+			for( ; runner != last; runner++ )
+				{
+				if( runner->action != ttMove.action && !isRefute( runner->action ) )
+					{
+					return runner++;
+					}
+				}
+			runner = badCaptures;
+			last = badEnd;
+			stage = PICK_BAD_CAPTURES;
+			// Fall through
+
+		case PICK_BAD_CAPTURES:
+			for( ; runner != last; runner++ )
+				{
+				if( runner->action != ttMove.action )
+					{
+					return runner++;
+					}
+				}
+			stage = PICK_DONE;
+			// Fall through
+
+		default:
+			return nullptr;
+		}
+	}
+
+
+/******************************************************
+* Store Refutation
+* Records a quiet move that caused a cutoff as a killer
+* for this ply and as the countermove to the move that
+* led here
+******************************************************/
+void storeRefutation( RefutationTable* refutations, Chess::State* state, Action action )
+	{
+	Action* killers = refutations->killers[ state->ply ];
+	Action previous = ( state->ply > 0 ? state->undoStack[ state->ply - 1 ].action : NULL_ACTION );
+	int i;
+
+	if( killers[ 0 ] != action )
+		{
+		for( i = KILLER_SLOTS - 1; i > 0; i-- )
+			{
+			killers[ i ] = killers[ i - 1 ];
+			}
+		killers[ 0 ] = action;
+		}
+	if( previous != NULL_ACTION )
+		{
+		refutations->counterMoves[ ACTION_FROM( previous ) ][ ACTION_TO( previous ) ] = action;
+		}
+	return;
+	}
+
+
+/******************************************************
+* Update History
+* Moves a history score toward +/- HISTORY_MAX by bonus,
+* scaled down the closer it already is. Scores can
+* never leave that range, and a move that stops working
+* loses its standing quickly.
+******************************************************/
+void updateHistory( HistoryTable* history, int side, Action action, int bonus )
+	{
+	int16_t& score = history->scores[ side ][ ACTION_FROM( action ) ][ ACTION_TO( action ) ];
+
+	bonus = std::max( -HISTORY_MAX_BONUS, std::min( bonus, HISTORY_MAX_BONUS ) );
+	score += bonus - score * std::abs( bonus ) / HISTORY_MAX;
+	return;
+	}
+
+
+/******************************************************
+* Age History
+* Halves every score, so that what was learned on
+* earlier turns still guides ordering but gives way to
+* the current position
+******************************************************/
+void ageHistory( HistoryTable* history )
+	{
+	int side, from, to;
+	for( side = 0; side < 2; side++ )
+		{
+		for( from = 0; from < 64; from++ )
+			{
+			for( to = 0; to < 64; to++ )
+				{
+				history->scores[ side ][ from ][ to ] /= 2;
+				}
+			}
+		}
+	return;
+	}
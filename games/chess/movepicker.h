@@ -0,0 +1,114 @@
+/**************************************************************
+* movepicker.h
+* Declarations for the chess staged move picker
+* CS5400, FS 2016
+* Stuart Miller
+**************************************************************/
+#ifndef JOUEUR_CHESS_MOVEPICKER_H
+#define JOUEUR_CHESS_MOVEPICKER_H
+
+/******************************************************
+* Includes
+******************************************************/
+#include "state.h"
+
+
+/******************************************************
+* Compiler Constants
+******************************************************/
+#define KILLER_SLOTS		( 2 )
+#define HISTORY_MAX			( 8192 )
+#define HISTORY_MAX_BONUS	( 1024 )
+
+
+/******************************************************
+* Types
+******************************************************/
+// Butterfly history: a score per quiet move, indexed by
+// the mover's color and the from and to squares, raised
+// when the move causes a cutoff and lowered when it was
+// tried first and did not
+typedef struct
+	{
+	int16_t		scores[ 2 ][ 64 ][ 64 ];
+	} HistoryTable;
+
+// Quiet moves that caused a cutoff, kept per ply, and
+// the quiet reply that last refuted each move, indexed
+// by that move's from and to squares
+typedef struct
+	{
+	Action		killers[ MAX_PLY ][ KILLER_SLOTS ];
+	Action		counterMoves[ 64 ][ 64 ];
+	} RefutationTable;
+
+// Stages are run in this order. Each generating stage
+// fills in the list used by the stage after it.
+typedef enum
+	{
+	PICK_TT_MOVE,
+	PICK_GEN_CAPTURES,
+	PICK_GOOD_CAPTURES,
+	PICK_KILLERS,
+	PICK_GEN_QUIETS,
+	PICK_QUIETS,
+	PICK_BAD_CAPTURES,
+	PICK_DONE
+	} PickStage;
+
+
+/**************************************************************
+* Action Sort Functor
+* Allows std::sort to order a frontier by its history table
+* scores, returning the higher value to result in a decending
+* sort
+**************************************************************/
+struct ActionSort
+	{
+	inline bool operator() ( const ScoredAction& x, const ScoredAction& y )
+		{
+		return( x.score > y.score );
+		}
+	};
+
+
+/******************************************************
+* Move Picker Class
+* Hands out the moves of a node one at a time, best
+* first, and only generates a group of moves once the
+* ones before it have been used up. A cutoff on the
+* transposition table move or a capture never pays for
+* the quiet moves.
+******************************************************/
+class MovePicker
+	{
+	public:
+		MovePicker( Chess::State* state, Action ttAction, HistoryTable* history, RefutationTable* refutations );
+
+		ScoredAction* next();
+
+	private:
+		Chess::State*	state;
+		HistoryTable*	history;
+		PickStage		stage;
+		ScoredAction	ttMove;
+		ScoredAction	refutes[ KILLER_SLOTS + 1 ];
+		int				numRefutes;
+		ActionList		moves;
+		ScoredAction*	runner;
+		ScoredAction*	last;
+		ScoredAction*	badCaptures;
+		ScoredAction*	badEnd;
+
+		bool isRefute( Action action ) const;
+	};
+
+
+/******************************************************
+* Function Declarations
+******************************************************/
+void storeRefutation( RefutationTable* refutations, Chess::State* state, Action action );
+void updateHistory( HistoryTable* history, int side, Action action, int bonus );
+void ageHistory( HistoryTable* history );
+
+#endif
@@ -0,0 +1,41 @@
+/**************************************************************
+* pawntable.cpp
+* Definitions for the chess pawn structure hash table
+* CS5400, FS 2016
+* Stuart Miller
+**************************************************************/
+
+
+/******************************************************
+* Includes
+******************************************************/
+#include "pawntable.h"
+#include <memory>
+
+
+/******************************************************
+* Local Variables
+******************************************************/
+// One table per thread, so split searches never share
+// an entry while it is being filled in. It is only
+// allocated by a thread's first probe, and lives on the
+// heap rather than in every thread's static TLS.
+static thread_local std::unique_ptr<PawnEntry[]> pawnTable;
+
+
+/******************************************************
+* Probe Pawn Table
+* Returns the slot for pawnKey. The caller must check
+* the slot's key, and fill the slot in if it holds a
+* different pawn structure. Entries start zeroed, which
+* is already the correct result for a board with no
+* pawns, whose pawn key is zero.
+******************************************************/
+PawnEntry* probePawnTable( Key pawnKey )
+	{
+	if( !pawnTable )
+		{
+		pawnTable.reset( new PawnEntry[ PAWN_TABLE_SZ ]() );
+		}
+	return &pawnTable[ pawnKey & ( PAWN_TABLE_SZ - 1 ) ];
+	}
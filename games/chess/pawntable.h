@@ -0,0 +1,47 @@
+/**************************************************************
+* pawntable.h
+* Declarations for the chess pawn structure hash table
+* CS5400, FS 2016
+* Stuart Miller
+**************************************************************/
+#ifndef JOUEUR_CHESS_PAWNTABLE_H
+#define JOUEUR_CHESS_PAWNTABLE_H
+
+/******************************************************
+* Includes
+******************************************************/
+#include "bitboard.h"
+#include "zobrist.h"
+#include "score.h"
+
+
+/******************************************************
+* Compiler Constants
+******************************************************/
+#define PAWN_TABLE_SZ		( 16384 )
+
+
+/******************************************************
+* Types
+******************************************************/
+// Pawn structure terms for one arrangement of pawns,
+// indexed by absolute color. Only depends on where the
+// pawns stand, so it can be reused by every position
+// with the same pawn key.
+typedef struct
+	{
+	Key			key;
+	Bitboard	doubled[ 2 ];
+	Bitboard	isolated[ 2 ];
+	Bitboard	backward[ 2 ];
+	Bitboard	passed[ 2 ];
+	Score		score[ 2 ];
+	} PawnEntry;
+
+
+/******************************************************
+* Function Declarations
+******************************************************/
+PawnEntry* probePawnTable( Key pawnKey );
+
+#endif
@@ -0,0 +1,32 @@
+/**************************************************************
+* score.h
+* Declarations for the chess packed evaluation score
+* CS5400, FS 2016
+* Stuart Miller
+**************************************************************/
+#ifndef JOUEUR_CHESS_SCORE_H
+#define JOUEUR_CHESS_SCORE_H
+
+/******************************************************
+* Includes
+******************************************************/
+#include <cstdint>
+
+
+/******************************************************
+* Types
+******************************************************/
+typedef int Score;
+
+
+/******************************************************
+* Macros
+******************************************************/
+// Packed evaluation score: midgame value in the low 16
+// bits, endgame value in the high 16, so that one add
+// or subtract updates both
+#define MAKE_SCORE( mg, eg )		( ( Score )( ( unsigned int )( eg ) << 16 ) + ( mg ) )
+#define MG_SCORE( s )				( ( int )( int16_t )( uint16_t )( unsigned int )( s ) )
+#define EG_SCORE( s )				( ( int )( int16_t )( uint16_t )( ( ( unsigned int )( s ) + 0x8000 ) >> 16 ) )
+
+#endif
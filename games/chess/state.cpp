@@ -15,41 +15,53 @@
 #include "game.h"
 #include "piece.h"
 #include "globals.h"
+#include "attacks.h"
 #include <map>
 #include <cmath>
 #include <functional>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstring>
 
 
 #define NOT_THREATENED	( -1 )
+#define PROMOTION_RANKS	( 0xFF000000000000FFULL )
+#define SQUARES_MASK	( 0x0FFF )
 
 /******************************************************
 * Macros
 ******************************************************/
-#define inSameRow( x, y )		( ( ( x ) / 8 ) == ( ( y ) / 8 ) )
 #define rankDiff( x, y )		( abs( ( ( x ) / 8 ) - ( ( y ) / 8 ) ) )
 #define isValidIdx( x )			( ( ( x ) <= 63 ) && ( ( x ) >= 0 ) )
 #define oneRowCross( x, y )		( std::abs( ( ( x ) % 8 ) - ( ( y ) % 8 ) ) == 7 )
-#define twoRowCross( x, y )		( std::abs( ( ( x ) % 8 ) - ( ( y ) % 8 ) ) > 5 )
 #define getRankNum( x )			( ( x ) / 8 )
 #define getFileNum( x )			( ( x ) % 8 )
-#define testIdx( bb, idx )		( isValidIdx( idx ) ? bb.test( idx ) : false )
+#define testIdx( bb, idx )		( isValidIdx( idx ) ? ( bb & BIT( idx ) ) : false )
+#define pinRay( pinned, king, idx )	( ( ( pinned ) & BIT( idx ) ) ? lineBB[ king ][ idx ] : ~( Bitboard )0 )
+#define taper( s, phase )		( ( MG_SCORE( s ) * ( phase ) + EG_SCORE( s ) * ( PHASE_MAX - ( phase ) ) ) / PHASE_MAX )
+
+// Pawn set operations toward the given side's front
+// (forward) or back (rear)
+#define pawnPush( bb, side )	( ( side ) == WHITE ? ( bb ) << 8 : ( bb ) >> 8 )
+#define frontFill( bb, side )	( ( side ) == WHITE ? northFill( bb ) : southFill( bb ) )
+#define rearFill( bb, side )	( ( side ) == WHITE ? southFill( bb ) : northFill( bb ) )
 
 
 /******************************************************
 * Local Variables
 ******************************************************/
-static const int index64[ 64 ] = {
-	0,  1, 48,  2, 57, 49, 28,  3,
-	61, 58, 50, 42, 38, 29, 17,  4,
-	62, 55, 59, 36, 53, 51, 43, 22,
-	45, 39, 33, 30, 24, 18, 12,  5,
-	63, 47, 56, 27, 60, 41, 37, 16,
-	54, 35, 52, 21, 44, 32, 23, 11,
-	46, 26, 40, 15, 34, 20, 31, 10,
-	25, 14, 19,  9, 13,  8,  7,  6
+// Castling rights left after a move touches each square
+static const int castleMasks[ 64 ] = {
+	13, 15, 15, 15, 12, 15, 15, 14,
+	15, 15, 15, 15, 15, 15, 15, 15,
+	15, 15, 15, 15, 15, 15, 15, 15,
+	15, 15, 15, 15, 15, 15, 15, 15,
+	15, 15, 15, 15, 15, 15, 15, 15,
+	15, 15, 15, 15, 15, 15, 15, 15,
+	15, 15, 15, 15, 15, 15, 15, 15,
+	 7, 15, 15, 15,  3, 15, 15, 11
 	};
-static const int knightMoves[ 8 ]	= { -17, -15, -10, -6, 6, 10, 15, 17 };
-static const int kingMoves[ 8 ]		= {  -9,  -8,  -7, -1, 1,  7,  8,  9 };
 static const int pawnSquareVal[ 64 ] = {
 	0, 0, 0, 0, 0, 0, 0, 0,
 	50, 50, 50, 50, 50, 50, 50, 50,
@@ -121,204 +133,273 @@ static const int kingEndgameSquareVal[ 64 ] = {
 	-50,-30,-30,-30,-30,-30,-30,-50
 	};
 static const int* squareVals[ 6 ] = { pawnSquareVal, rookSquareVal, knightSquareVal, bishopSquareVal, queenSquareVal, kingMidgameSquareVal };
+static const int* endgameSquareVals[ 6 ] = { pawnSquareVal, rookSquareVal, knightSquareVal, bishopSquareVal, queenSquareVal, kingEndgameSquareVal };
+
+// Bonus for a passed pawn by how far it has advanced,
+// worth more once the pieces that could stop it are gone
+static const Score passedPawnBonus[ 8 ] = {
+	MAKE_SCORE( 0, 0 ), MAKE_SCORE( 0, 1 ), MAKE_SCORE( 1, 2 ), MAKE_SCORE( 1, 4 ),
+	MAKE_SCORE( 3, 7 ), MAKE_SCORE( 5, 12 ), MAKE_SCORE( 8, 20 ), MAKE_SCORE( 0, 0 )
+	};
+
+// Weight of each piece type toward the game phase
+static const int phaseWeights[ 6 ] = { 0, 2, 1, 1, 4, 0 };
+
+// Packed midgame and endgame piece-square value of a
+// piece of the given color. The tables are laid out
+// from white's side of the board.
+static inline Score squareValue( int side, int piece, int idx )
+	{
+	idx = ( side == WHITE ? 63 - idx : idx );
+	return MAKE_SCORE( squareVals[ piece ][ idx ], endgameSquareVals[ piece ][ idx ] );
+	}
+
+// Squares attacked by a piece other than a pawn on idx,
+// given the occupancy of the whole board
+static inline Bitboard pieceAttacks( int piece, int idx, Bitboard occ )
+	{
+	switch( piece )
+		{
+		case ROOK:		return rookAttacks( idx, occ );
+		case KNIGHT:	return knightAttacks[ idx ];
+		case BISHOP:	return bishopAttacks( idx, occ );
+		case QUEEN:		return queenAttacks( idx, occ );
+		default:		return kingAttacks[ idx ];
+		}
+	}
+
+// Order in which exchanges are played out by see()
+static const PieceType seeOrder[ 6 ] = { PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING };
+const PieceType promotionPieces[ 4 ] = { KNIGHT, BISHOP, ROOK, QUEEN };
 
 
 /******************************************************
-* Copy Constructor
-* Performs a deep copy of the passed state
+* Equality Operator
+* Compares Zobrist keys, which cover the board layout,
+* side to move, castling rights and en passant file
 ******************************************************/
-Chess::State::State( Chess::State* x )
+bool Chess::State::operator == ( const Chess::State & other ) const
 	{
-	myPawns		= x->myPawns;
-	myRooks		= x->myRooks;
-	myKnights	= x->myKnights;
-	myBishops	= x->myBishops;
-	myQueens	= x->myQueens;
-	myKing		= x->myKing;
-	oppPawns	= x->oppPawns;
-	oppRooks	= x->oppRooks;
-	oppKnights	= x->oppKnights;
-	oppBishops	= x->oppBishops;
-	oppQueens	= x->oppQueens;
-	oppKing		= x->oppKing;
-	color		= x->color;
-	misc		= x->misc;
-	parent		= x;
+	return( key == other.key );
 	}
 
 
 /******************************************************
-* Assignment Operator
-* Performs a deep copy of the passed state
+* Compute Key
+* Builds the Zobrist key from scratch. makeMove() keeps
+* key up to date incrementally; this is only needed
+* when a state is first constructed, or to check the
+* incremental key.
 ******************************************************/
-Chess::State& Chess::State::operator = ( Chess::State &rhs )
+Key Chess::State::computeKey() const
 	{
-	myPawns		= rhs.myPawns;
-	myRooks		= rhs.myRooks;
-	myKnights	= rhs.myKnights;
-	myBishops	= rhs.myBishops;
-	myQueens	= rhs.myQueens;
-	myKing		= rhs.myKing;
-	oppPawns	= rhs.oppPawns;
-	oppRooks	= rhs.oppRooks;
-	oppKnights	= rhs.oppKnights;
-	oppBishops	= rhs.oppBishops;
-	oppQueens	= rhs.oppQueens;
-	oppKing		= rhs.oppKing;
-	color		= rhs.color;
-	misc		= rhs.misc;
-	score		= rhs.score;
-	historyVal	= rhs.historyVal;
-	parent		= &rhs;
+	Key result = castlingKeys[ castling ];
+	Bitboard board;
+	int i, j;
+	for( i = 0; i < 2; i++ )
+		{
+		for( j = 0; j < 6; j++ )
+			{
+			board = pieces[ i ][ j ];
+			while( board )
+				{
+				result ^= pieceKeys[ sideColor( i ) ][ j ][ popLsb( board ) ];
+				}
+			}
+		}
+	if( epSquare != NO_SQUARE )
+		result ^= epKeys[ getFileNum( epSquare ) ];
+	if( sideColor( turn ) == BLACK )
+		result ^= sideKey;
+	return result;
 	}
 
-bool Chess::State::operator == ( const Chess::State & other ) const
+
+/******************************************************
+* Compute Pawn Key
+* Builds the Zobrist key of the pawns alone, which
+* indexes the pawn structure table. Kept up to date by
+* makeMove() alongside key.
+******************************************************/
+Key Chess::State::computePawnKey() const
+	{
+	Key result = 0;
+	Bitboard board;
+	int i;
+	for( i = 0; i < 2; i++ )
+		{
+		board = pieces[ i ][ PAWN ];
+		while( board )
+			{
+			result ^= pieceKeys[ sideColor( i ) ][ PAWN ][ popLsb( board ) ];
+			}
+		}
+	return result;
+	}
+
+
+/******************************************************
+* Compute Evaluation Terms
+* Sums material and piece-square values for each player
+* from scratch. makeMove() keeps the State's copies up
+* to date; this seeds them and checks them.
+******************************************************/
+void Chess::State::computeEval( int* material, Score* psq ) const
 	{
-	return 	myPawns == other.myPawns &&
-			myRooks == other.myRooks &&
-			myKnights == other.myKnights &&
-			myBishops == other.myBishops &&
-			myQueens == other.myQueens &&
-			myKing == other.myKing &&
-			oppPawns == other.oppPawns &&
-			oppRooks == other.oppRooks &&
-			oppKnights == other.oppKnights &&
-			oppBishops == other.oppBishops &&
-			oppQueens == other.oppQueens &&
-			oppKing == other.oppKing;
+	Bitboard board;
+	int i, j;
+	for( i = 0; i < 2; i++ )
+		{
+		material[ i ] = 0;
+		psq[ i ] = 0;
+		for( j = 0; j < 6; j++ )
+			{
+			board = pieces[ i ][ j ];
+			material[ i ] += pieceValue( ( PieceType )j ) * popCount( board );
+			while( board )
+				{
+				psq[ i ] += squareValue( sideColor( i ), j, popLsb( board ) );
+				}
+			}
+		}
+	return;
 	}
 
 
 /******************************************************
-* State Constructor
-* constructs an initial state from the passed game 
-* and AI objects
+* FEN Constructor
+* Constructs a state from a Forsyth-Edwards string. The
+* side to move is always treated as ME.
 ******************************************************/
-Chess::State::State( Chess::AI* ai )
+Chess::State::State( const std::string& fen )
 	{
-	// conversion map
-	std::map<std::string, Bitboard*> pieceConvert;
-	pieceConvert[ "myPawn" ]	= &myPawns;
-	pieceConvert[ "myRook" ]	= &myRooks;
-	pieceConvert[ "myKnight" ]	= &myKnights;
-	pieceConvert[ "myBishop" ]	= &myBishops;
-	pieceConvert[ "myQueen" ]	= &myQueens;
-	pieceConvert[ "myKing" ]	= &myKing;
-	pieceConvert[ "oppPawn" ]	= &oppPawns;
-	pieceConvert[ "oppRook" ]	= &oppRooks;
-	pieceConvert[ "oppKnight" ] = &oppKnights;
-	pieceConvert[ "oppBishop" ] = &oppBishops;
-	pieceConvert[ "oppQueen" ]	= &oppQueens;
-	pieceConvert[ "oppKing" ]	= &oppKing;
-
-	// Initialize all bitboards to zero
-	myPawns		= 0;
-	myRooks		= 0;
-	myKnights	= 0;
-	myBishops	= 0;
-	myQueens	= 0;
-	myKing		= 0;
-	oppPawns	= 0;
-	oppRooks	= 0;
-	oppKnights	= 0;
-	oppBishops	= 0;
-	oppQueens	= 0;
-	oppKing		= 0;
-	misc		= 0;
-
-	std::vector<Chess::Piece*>::iterator piece;
-	std::vector<Chess::Piece*>::iterator end;
-
-	// Read in our color
-	color = BLACK;
-	if( ai->player->color == "White" )
-		{
-		color = WHITE;
-		}
-
-	// Parse FEN string for en passant and castling
-	std::string fen = ai->game->fen;
-	int i = fen.find_first_of( ' ' );
-	for( i = i + 3; fen[ i ] != ' '; i++ )
-		{
-		if( fen[ i ] == 'Q' )
-			misc.set( 0 );
-		else if( fen[ i ] == 'K' )
-			misc.set( 8 );
-		else if( fen[ i ] == 'q' )
-			misc.set( 56 );
-		else if( fen[ i ] == 'k' )
-			misc.set( 63 );
-		}
-	if( fen[ i + 1 ] != '-' )
-		misc.set( getBitboardIdx( fen[ i + 2 ] - 48, string( 1, fen[ i + 1 ] ) ) );
-
-	// Read in our pieces
-	piece = ai->player->pieces.begin();
-	end = ai->player->pieces.end();
-	for( piece; piece != end; piece++ )
-		( pieceConvert[ ( "my" + ( *piece )->type ) ] )->set( getBitboardIdx( ( *piece )->rank, ( *piece )->file ) );
-
-	// Read in our opponent's pieces
-	piece = ai->player->opponent->pieces.begin();
-	end = ai->player->opponent->pieces.end();
-	for( piece; piece != end; piece++ )
-		{
-		( pieceConvert[ ( "opp" + ( *piece )->type ) ] )->set( getBitboardIdx( ( *piece )->rank, ( *piece )->file ) );
+	static const std::string pieceChars = "prnbqk";
+	std::string placement, sideToMove, rights, ep;
+	int i, rank, file, owner;
+	size_t c;
+
+	// Clear board
+	for( i = 0; i < 6; i++ )
+		{
+		pieces[ ME ][ i ]		= 0;
+		pieces[ OPPONENT ][ i ]	= 0;
 		}
-	
-	// Read in our last move
-	std::vector<Chess::Move*> moves = ai->game->moves;
-	int moveSz = moves.size();
-	misc = 0;
-	if( moveSz > 0 )
+	castling	= 0;
+	epSquare	= NO_SQUARE;
+	score		= 0;
+	ply			= 0;
+	turn		= ME;
+
+	// Split into fields
+	std::istringstream fields( fen );
+	fields >> placement >> sideToMove >> rights >> ep;
+	color = ( sideToMove == "b" ? BLACK : WHITE );
+
+	// Read in pieces, starting from the eighth rank
+	rank = 7;
+	file = 0;
+	for( c = 0; c < placement.size(); c++ )
 		{
-		misc |= ( ( unsigned long long )getBitboardIdx( moves.back()->fromRank, moves.back()->fromFile ) << FROMIDX_BITSHIFT );
-		misc |= ( ( unsigned long long )getBitboardIdx( moves.back()->toRank, moves.back()->toFile ) << TOIDX_BITSHIFT );
+		if( placement[ c ] == '/' )
+			{
+			rank--;
+			file = 0;
+			}
+		else if( isdigit( placement[ c ] ) )
+			{
+			file += placement[ c ] - '0';
+			}
+		else
+			{
+			owner = ( ( isupper( placement[ c ] ) ? WHITE : BLACK ) == color ? ME : OPPONENT );
+			pieces[ owner ][ pieceChars.find( tolower( placement[ c ] ) ) ] |= BIT( file + ( rank * 8 ) );
+			file++;
+			}
 		}
 
-	// Build up previous states to check for state repetition
-	parent = nullptr;
-	Chess::State* lastState = this;
-	for( i = moveSz - 2; i >= moveSz - 8 && i >= 0; i-- )
+	// Castling rights and en passant target
+	for( c = 0; c < rights.size(); c++ )
 		{
-		Chess::State* newState = new State( this );
-		newState->parent = nullptr;
-		lastState->parent = newState;
-		lastState = newState;
-		newState->misc = 0;
-		newState->misc |= ( ( unsigned long long )getBitboardIdx( moves[ i ]->fromRank, moves[ i ]->fromFile ) << FROMIDX_BITSHIFT );
-		newState->misc |= ( ( unsigned long long )getBitboardIdx( moves[ i ]->toRank, moves[ i ]->toFile ) << TOIDX_BITSHIFT );
+		if( rights[ c ] == 'K' )
+			castling |= WHITE_OO;
+		else if( rights[ c ] == 'Q' )
+			castling |= WHITE_OOO;
+		else if( rights[ c ] == 'k' )
+			castling |= BLACK_OO;
+		else if( rights[ c ] == 'q' )
+			castling |= BLACK_OOO;
 		}
+	if( ep.size() == 2 )
+		epSquare = getBitboardIdx( ep[ 1 ] - '0', ep.substr( 0, 1 ) );
 
-	return;
+	key = computeKey();
+	pawnKey = computePawnKey();
+	computeEval( material, psq );
 	}
 
 
 /******************************************************
-* Is State NonQuiescent?
-* Hueristic for determining nonquiescence. Simply
-* checks if either player is in check.
+* State Constructor
+* constructs an initial state from the passed game 
+* and AI objects
 ******************************************************/
-bool Chess::State::isNonQuiescent()
+Chess::State::State( Chess::AI* ai ) : State( ai->game->fen )
 	{
-	int kingIdx;
-
-	// Check if we're in check
-	kingIdx = bitScanForward( myKing );
-	if( isThreatened( kingIdx, kingIdx, kingIdx, ME ) != NOT_THREATENED )
-		{
-		return true;
-		}
-	
-	// Check if we've put our opponent in check
-	kingIdx = bitScanForward( oppKing );
-	if( isThreatened( kingIdx, kingIdx, kingIdx, OPPONENT ) != NOT_THREATENED )
+	// Seed the undo stack with our last few moves so that
+	// repetitions across the root can still be detected.
+	// These entries are never unmade.
+	std::vector<Chess::Move*>& moves = ai->game->moves;
+	int moveSz = moves.size();
+	int i, from_idx, to_idx;
+	for( i = std::max( 0, moveSz - 8 ); i < moveSz; i++ )
 		{
-		return true;
+		from_idx = getBitboardIdx( moves[ i ]->fromRank, moves[ i ]->fromFile );
+		to_idx = getBitboardIdx( moves[ i ]->toRank, moves[ i ]->toFile );
+		Undo& undo		= undoStack[ ply++ ];
+		undo.action		= ACTION( from_idx, to_idx, QUIET, NO_PIECE, NO_PIECE );
+		undo.key		= 0;
+		undo.pawnKey	= 0;
+		undo.epSquare	= NO_SQUARE;
+		undo.castling	= castling;
 		}
 
-	return false;
+	return;
+	}
+
+
+/******************************************************
+* Copy From
+* Copies the position in other and the part of its undo
+* stack in use, leaving the rest of the stack alone.
+* Much cheaper than assigning the whole State.
+******************************************************/
+void Chess::State::copyFrom( const Chess::State& other )
+	{
+	std::memcpy( pieces, other.pieces, sizeof( pieces ) );
+	key				= other.key;
+	pawnKey			= other.pawnKey;
+	material[ 0 ]	= other.material[ 0 ];
+	material[ 1 ]	= other.material[ 1 ];
+	psq[ 0 ]		= other.psq[ 0 ];
+	psq[ 1 ]		= other.psq[ 1 ];
+	castling		= other.castling;
+	epSquare		= other.epSquare;
+	score			= other.score;
+	ply				= other.ply;
+	turn			= other.turn;
+	color			= other.color;
+	std::copy( other.undoStack, other.undoStack + other.ply, undoStack );
+	return;
+	}
+
+
+/******************************************************
+* In Check
+* True if the side to move's king is attacked
+******************************************************/
+bool Chess::State::inCheck()
+	{
+	return( isThreatened( lsb( pieces[ turn ][ KING ] ), turn ) != NOT_THREATENED );
 	}
 
 /******************************************************
@@ -331,18 +412,40 @@ int getBitboardIdx( int rank, std::string file )
 	}
 
 
+/******************************************************
+* Piece Value
+* Configured material value of a piece type, zero for
+* NO_PIECE
+******************************************************/
+int pieceValue( PieceType piece )
+	{
+	switch( piece )
+		{
+		case PAWN:		return pawnVal;
+		case ROOK:		return rookVal;
+		case KNIGHT:	return knightVal;
+		case BISHOP:	return bishopVal;
+		case QUEEN:		return queenVal;
+		case KING:		return kingVal;
+		default:		return 0;
+		}
+	}
+
+
 /******************************************************
 * Print Bitboard
 * Formats and prints a bitobard to the console
 ******************************************************/
 void print_bitboard( Bitboard* bitboard )
 	{
-	std::string str = "Val: " + bitboard->to_string() + "\n";
+	std::stringstream val;
+	val << std::hex << std::setw( 16 ) << std::setfill( '0' ) << *bitboard;
+	std::string str = "Val: " + val.str() + "\n";
 	for( int i = 7; i >= 0; i-- )
 		{
 		for( int j = 0; j <= 7; j++ )
 			{
-			if( ( *bitboard ).test( j + ( i * 8 ) ) )
+			if( *bitboard & BIT( j + ( i * 8 ) ) )
 				{
 				str += "O";
 				}
@@ -361,203 +464,203 @@ void print_bitboard( Bitboard* bitboard )
 * Actions Function
 * Generates all possible moves from the current state
 ******************************************************/
-void Chess::State::Actions( std::vector<Chess::State*>& frontier, int player )
+void Chess::State::Actions( ActionList& frontier )
+	{
+	generateMoves( frontier, GEN_ALL );
+	return;
+	}
+
+
+/******************************************************
+* Captures Function
+* Generates only captures and promotions, for the
+* quiescence search
+******************************************************/
+void Chess::State::Captures( ActionList& frontier )
+	{
+	generateMoves( frontier, GEN_CAPTURES );
+	return;
+	}
+
+
+/******************************************************
+* Quiets Function
+* Generates every move Captures() leaves out: quiet
+* piece moves, non-promoting pushes and castling
+******************************************************/
+void Chess::State::Quiets( ActionList& frontier )
+	{
+	generateMoves( frontier, GEN_QUIETS );
+	return;
+	}
+
+
+/******************************************************
+* Generate Moves
+* Shared generator behind Actions(), Captures() and
+* Quiets(). The type limits piece moves to enemy or
+* empty squares, and splits pawn moves so that every
+* promotion counts as a capture.
+******************************************************/
+void Chess::State::generateMoves( ActionList& frontier, int type )
 	{
 	/**************************************************
 	* Declarations
 	**************************************************/
-	Bitboard allMy, allOpp, pieces;
-	Bitboard *pawns, *rooks, *knights, *bishops, *queens, *king;
-	int dir, idx, new_idx, i, pawnRank;
-	if( player == ME )
-		{
-		pawns	= &myPawns;
-		rooks	= &myRooks;
-		knights = &myKnights;
-		bishops = &myBishops;
-		queens	= &myQueens;
-		king	= &myKing;
-		allMy	= myPawns | myKnights | myBishops | myRooks | myQueens | myKing;
-		allOpp	= oppPawns | oppKnights | oppBishops | oppRooks | oppQueens | oppKing;
-		dir		= ( color == BLACK ? -1 : 1 );
-		pawnRank= ( color == BLACK ?  6 : 1 );
-		}
+	int player = turn;
+	Bitboard* mine = this->pieces[ player ];
+	Bitboard* theirs = this->pieces[ !player ];
+	Bitboard allMy = sidePieces( player );
+	Bitboard allOpp = sidePieces( !player );
+	Bitboard all = allMy | allOpp;
+	Bitboard mask = ( type == GEN_CAPTURES ? allOpp : ( type == GEN_QUIETS ? ~all : ~allMy ) );
+	Bitboard pushMask = ( type == GEN_CAPTURES ? PROMOTION_RANKS : ( type == GEN_QUIETS ? ~PROMOTION_RANKS : ~0ULL ) );
+	Bitboard pieces, targets, snipers, blockers;
+	Bitboard checkers, checkMask, pinned;
+	int side = sideColor( player );
+	int dir = ( side == BLACK ? -8 : 8 );
+	int pawnRank = ( side == BLACK ? 6 : 1 );
+	int king = lsb( mine[ KING ] );
+	int idx, new_idx, i, base;
+
+	/**************************************************
+	* Check and Pin Masks
+	* Only moves that block or capture a single checker
+	* are allowed while in check, none but king moves in
+	* double check, and a pinned piece may only move along
+	* the line through its king and the pinning slider.
+	* Everything generated below is then legal without
+	* trying it on the board, apart from en passant.
+	**************************************************/
+	checkers = attackersTo( king, all ) & allOpp;
+	if( !checkers )
+		checkMask = ~( Bitboard )0;
+	else if( !( checkers & ( checkers - 1 ) ) )
+		checkMask = checkers | betweenBB[ king ][ lsb( checkers ) ];
 	else
+		checkMask = 0;
+
+	pinned = 0;
+	snipers = ( rookAttacks( king, allOpp ) & ( theirs[ ROOK ] | theirs[ QUEEN ] ) ) |
+			  ( bishopAttacks( king, allOpp ) & ( theirs[ BISHOP ] | theirs[ QUEEN ] ) );
+	while( snipers )
 		{
-		pawns	= &oppPawns;
-		rooks	= &oppRooks;
-		knights = &oppKnights;
-		bishops = &oppBishops;
-		queens	= &oppQueens;
-		king	= &oppKing;
-		allMy	= oppPawns | oppKnights | oppBishops | oppRooks | oppQueens | oppKing;
-		allOpp	= myPawns | myKnights | myBishops | myRooks | myQueens | myKing;
-		dir		= ( color == WHITE ? -1 : 1 );
-		pawnRank= ( color == WHITE ?  6 : 1 );
+		blockers = betweenBB[ king ][ popLsb( snipers ) ] & all;
+		if( blockers && !( blockers & ( blockers - 1 ) ) && ( blockers & allMy ) )
+			pinned |= blockers;
 		}
-	Bitboard all = allMy | allOpp;
 
 	/**************************************************
 	* Queen Move Validation
 	**************************************************/
-	pieces = *queens;
-	while( ( idx = bitScanForward( pieces ) ) != -1 )
+	pieces = mine[ QUEEN ];
+	while( pieces )
 		{
-		pieces.reset( idx );
-		for( i = idx + 8; ( isValidIdx( i ) && !allMy.test( i ) ); i += 8 )
-			{
-			addMove( frontier, idx, i, queens, player );
-			if( allOpp.test( i ) ) break;
-			}
-		for( i = idx - 8; ( isValidIdx( i ) && !allMy.test( i ) ); i -= 8 )
-			{
-			addMove( frontier, idx, i, queens, player );
-			if( allOpp.test( i ) ) break;
-			}
-		for( i = idx + 1; ( isValidIdx( i ) && !allMy.test( i ) ) && inSameRow( idx, i ); i += 1 )
-			{
-			addMove( frontier, idx, i, queens, player );
-			if( allOpp.test( i ) ) break;
-			}
-		for( i = idx - 1; ( isValidIdx( i ) && !allMy.test( i ) ) && inSameRow( idx, i ); i -= 1 )
-			{
-			addMove( frontier, idx, i, queens, player );
-			if( allOpp.test( i ) ) break;
-			}
-		for( i = idx + 9; ( isValidIdx( i ) && !allMy.test( i ) && ( getFileNum( i ) != 0 ) ); i += 9 )
-			{
-			addMove( frontier, idx, i, queens, player );
-			if( allOpp.test( i ) ) break;
-			}
-		for( i = idx - 9; ( isValidIdx( i ) && !allMy.test( i ) && ( getFileNum( i ) != 7 ) ); i -= 9 )
-			{
-			addMove( frontier, idx, i, queens, player );
-			if( allOpp.test( i ) ) break;
-			}
-		for( i = idx + 7; ( isValidIdx( i ) && !allMy.test( i ) && ( getFileNum( i ) != 7 ) ); i += 7 )
-			{
-			addMove( frontier, idx, i, queens, player );
-			if( allOpp.test( i ) ) break;
-			}
-		for( i = idx - 7; ( isValidIdx( i ) && !allMy.test( i ) && ( getFileNum( i ) != 0 ) ); i -= 7 )
+		idx = popLsb( pieces );
+		targets = queenAttacks( idx, all ) & mask & checkMask & pinRay( pinned, king, idx );
+		while( targets )
 			{
-			addMove( frontier, idx, i, queens, player );
-			if( allOpp.test( i ) ) break;
+			i = popLsb( targets );
+			addMove( frontier, idx, i, ( allOpp & BIT( i ) ) ? CAPTURE : QUIET, QUEEN );
 			}
-		}			
+		}
 
 	/**************************************************
 	* Rook Move Validation
 	**************************************************/
-	pieces = *rooks;
-	while( ( idx = bitScanForward( pieces ) ) != -1 )
+	pieces = mine[ ROOK ];
+	while( pieces )
 		{
-		pieces.reset( idx );
-		for( i = idx + 8; ( isValidIdx( i ) && !allMy.test( i ) ); i += 8 )
-			{
-			addMove( frontier, idx, i, rooks, player );
-			if( allOpp.test( i ) ) break;
-			}
-		for( i = idx - 8; ( isValidIdx( i ) && !allMy.test( i ) ); i -= 8 )
-			{
-			addMove( frontier, idx, i, rooks, player );
-			if( allOpp.test( i ) ) break;
-			}
-		for( i = idx + 1; ( isValidIdx( i ) && !allMy.test( i ) ) && inSameRow( idx, i ); i += 1 )
-			{
-			addMove( frontier, idx, i, rooks, player );
-			if( allOpp.test( i ) ) break;
-			}
-		for( i = idx - 1; ( isValidIdx( i ) && !allMy.test( i ) ) && inSameRow( idx, i ); i -= 1 )
+		idx = popLsb( pieces );
+		targets = rookAttacks( idx, all ) & mask & checkMask & pinRay( pinned, king, idx );
+		while( targets )
 			{
-			addMove( frontier, idx, i, rooks, player );
-			if( allOpp.test( i ) ) break;
+			i = popLsb( targets );
+			addMove( frontier, idx, i, ( allOpp & BIT( i ) ) ? CAPTURE : QUIET, ROOK );
 			}
 		}
 
 	/**************************************************
 	* Bishop Move Validation
 	**************************************************/
-	pieces = *bishops;
-	while( ( idx = bitScanForward( pieces ) ) != -1 )
+	pieces = mine[ BISHOP ];
+	while( pieces )
 		{
-		pieces.reset( idx );
-		for( i = idx + 9; ( isValidIdx( i ) && !allMy.test( i ) && ( getFileNum( i ) != 0 ) ); i += 9 )
-			{
-			addMove( frontier, idx, i, bishops, player );
-			if( allOpp.test( i ) ) break;
-			}
-		for( i = idx - 9; ( isValidIdx( i ) && !allMy.test( i ) && ( getFileNum( i ) != 7 ) ); i -= 9 )
-			{
-			addMove( frontier, idx, i, bishops, player );
-			if( allOpp.test( i ) ) break;
-			}
-		for( i = idx + 7; ( isValidIdx( i ) && !allMy.test( i ) && ( getFileNum( i ) != 7 ) ); i += 7 )
-			{
-			addMove( frontier, idx, i, bishops, player );
-			if( allOpp.test( i ) ) break;
-			}
-		for( i = idx - 7; ( isValidIdx( i ) && !allMy.test( i ) && ( getFileNum( i ) != 0 ) ); i -= 7 )
+		idx = popLsb( pieces );
+		targets = bishopAttacks( idx, all ) & mask & checkMask & pinRay( pinned, king, idx );
+		while( targets )
 			{
-			addMove( frontier, idx, i, bishops, player );
-			if( allOpp.test( i ) ) break;
+			i = popLsb( targets );
+			addMove( frontier, idx, i, ( allOpp & BIT( i ) ) ? CAPTURE : QUIET, BISHOP );
 			}
 		}
 
 	/**************************************************
 	* Knight Move Validation
 	**************************************************/
-	pieces = *knights;
-	while( ( idx = bitScanForward( pieces ) ) != -1 )
+	pieces = mine[ KNIGHT ];
+	while( pieces )
 		{
-		pieces.reset( idx );
-		for( i = 0; i < 8; i++ )
+		idx = popLsb( pieces );
+		targets = knightAttacks[ idx ] & mask & checkMask & pinRay( pinned, king, idx );
+		while( targets )
 			{
-			new_idx = idx + knightMoves[ i ];
-			if( isValidIdx( new_idx ) && !allMy.test( new_idx ) && !twoRowCross( idx, new_idx ) )
-				addMove( frontier, idx, new_idx, knights, player );
+			i = popLsb( targets );
+			addMove( frontier, idx, i, ( allOpp & BIT( i ) ) ? CAPTURE : QUIET, KNIGHT );
 			}
 		}
 
 	/**************************************************
 	* King Move Validation
 	**************************************************/
-	idx = bitScanForward( *king );
-	for( i = 0; i < 8; i++ )
+	// The king is taken off the board when testing its
+	// targets, so it can't hide behind itself from a slider
+	targets = kingAttacks[ king ] & mask;
+	while( targets )
+		{
+		i = popLsb( targets );
+		if( !( attackersTo( i, all ^ BIT( king ) ) & allOpp ) )
+			addMove( frontier, king, i, ( allOpp & BIT( i ) ) ? CAPTURE : QUIET, KING );
+		}
+
+	// Castling
+	if( type != GEN_CAPTURES && !checkers )
 		{
-		new_idx = idx + kingMoves[ i ];
-		if( isValidIdx( new_idx ) && !allMy.test( new_idx ) && !oneRowCross( idx, new_idx ) )
-			addMove( frontier, idx, new_idx, king, player );
+		base = ( side == WHITE ? 0 : 56 );
+		if( canCastle( KING_CASTLE ) )
+			addMove( frontier, base + 4, base + 6, KING_CASTLE, KING );
+		if( canCastle( QUEEN_CASTLE ) )
+			addMove( frontier, base + 4, base + 2, QUEEN_CASTLE, KING );
 		}
-	new_idx = color == WHITE ? 0 : 56;
-	if( misc.test( new_idx ) && !misc.test( new_idx + 1 ) && !misc.test( new_idx + 2 ) && !misc.test( new_idx + 3 ) )
-		addMove( frontier, idx, new_idx, king, player );
-	new_idx += 7;
-	if( misc.test( new_idx ) && !misc.test( new_idx + 1 ) && !misc.test( new_idx + 2 ) )
-		addMove( frontier, idx, new_idx, king, player );
 
 	/**************************************************
 	* Pawn Move Validation
 	**************************************************/
-	pieces = *pawns;
-	while( ( idx = bitScanForward( pieces ) ) != -1 )
-		{
-		pieces.reset( idx );
-		new_idx = idx + ( 7 * dir );
-		if( isValidIdx( new_idx ) && allOpp.test( new_idx ) && !oneRowCross( idx, new_idx ) )
-			addMove( frontier, idx, new_idx, pawns, player );
-		else if( ( getRankNum( new_idx ) == 5 || getRankNum( new_idx ) == 2 ) && misc.test( new_idx ) && !oneRowCross( idx, new_idx ) )
-			addMove( frontier, idx, new_idx, pawns, player );
-		new_idx = idx + ( 8 * dir );
-		if( isValidIdx( new_idx ) && !all.test( new_idx ) )
-			addMove( frontier, idx, new_idx, pawns, player );
-		new_idx = idx + ( 9 * dir );
-		if( isValidIdx( new_idx ) && allOpp.test( new_idx ) && !oneRowCross( idx, new_idx ) )
-			addMove( frontier, idx, new_idx, pawns, player );
-		else if( ( getRankNum( new_idx ) == 5 || getRankNum( new_idx ) == 2 ) && misc.test( new_idx ) && !oneRowCross( idx, new_idx ) )
-			addMove( frontier, idx, new_idx, pawns, player );
-		if( getRankNum( idx ) == pawnRank && !all.test( idx + ( 16 * dir ) ) && !all.test( idx + ( 8 * dir ) ) )
-			addMove( frontier, idx, idx + ( 16 * dir ), pawns, player );
+	pieces = mine[ PAWN ];
+	while( pieces )
+		{
+		idx = popLsb( pieces );
+		if( type != GEN_QUIETS )
+			{
+			targets = pawnAttacks[ side ][ idx ] & allOpp & checkMask & pinRay( pinned, king, idx );
+			while( targets )
+				{
+				i = popLsb( targets );
+				addPawnMove( frontier, idx, i, CAPTURE );
+				}
+			if( epSquare != NO_SQUARE && ( pawnAttacks[ side ][ idx ] & BIT( epSquare ) ) )
+				addMove( frontier, idx, epSquare, EN_PASSANT, PAWN );
+			}
+		new_idx = idx + dir;
+		targets = checkMask & pinRay( pinned, king, idx );
+		if( !( all & BIT( new_idx ) ) && ( pushMask & BIT( new_idx ) ) )
+			{
+			if( targets & BIT( new_idx ) )
+				addPawnMove( frontier, idx, new_idx, QUIET );
+			if( type != GEN_CAPTURES && getRankNum( idx ) == pawnRank && !( all & BIT( new_idx + dir ) ) &&
+				( targets & BIT( new_idx + dir ) ) )
+				addMove( frontier, idx, new_idx + dir, DOUBLE_PUSH, PAWN );
+			}
 		}
 
 	return;
@@ -565,350 +668,777 @@ void Chess::State::Actions( std::vector<Chess::State*>& frontier, int player )
 
 
 /******************************************************
-* Forward Bit Scan
-* Returns the index of the first set bit
-* Source: https://chessprogramming.wikispaces.com/Bitscan
+* Can Castle
+* Tests the castling rights, the empty squares between
+* king and rook, and that the king does not leave,
+* cross or land on an attacked square
 ******************************************************/
-int bitScanForward( Bitboard bb )
+bool Chess::State::canCastle( int flags )
 	{
-	if( bb == 0 )
-		return -1;
-	unsigned long long bb_ull = bb.to_ullong();
-	const unsigned long long debruijn64 = 0x03f79d71b4cb0a89;
-	return index64[ ( ( bb_ull & -bb_ull ) * debruijn64 ) >> 58 ];
+	int player = turn;
+	int base = ( sideColor( player ) == WHITE ? 0 : 56 );
+	Bitboard all = sidePieces( ME ) | sidePieces( OPPONENT );
+
+	if( flags == KING_CASTLE )
+		{
+		return( ( castling & ( sideColor( player ) == WHITE ? WHITE_OO : BLACK_OO ) ) &&
+				!( all & ( BIT( base + 5 ) | BIT( base + 6 ) ) ) &&
+				isThreatened( base + 4, player ) == NOT_THREATENED &&
+				isThreatened( base + 5, player ) == NOT_THREATENED &&
+				isThreatened( base + 6, player ) == NOT_THREATENED );
+		}
+	return( ( castling & ( sideColor( player ) == WHITE ? WHITE_OOO : BLACK_OOO ) ) &&
+			!( all & ( BIT( base + 1 ) | BIT( base + 2 ) | BIT( base + 3 ) ) ) &&
+			isThreatened( base + 4, player ) == NOT_THREATENED &&
+			isThreatened( base + 3, player ) == NOT_THREATENED &&
+			isThreatened( base + 2, player ) == NOT_THREATENED );
 	}
 
 
 /******************************************************
-* Test if index is Threatened
-* If square is under attack, returns the index of the
-* square found to be attacking it
+* Is Valid Action
+* Checks that an action from outside the generator,
+* such as a transposition table move, could have been
+* generated in this state. Hash collisions can hand
+* back a move from an unrelated position.
 ******************************************************/
-int Chess::State::isThreatened( int idx, int to_idx, int from_idx, int player )
+bool Chess::State::isValid( Action action )
 	{
-	Bitboard allMy, allOpp, pieces;
-	Bitboard *pawns, *rooks, *knights, *bishops, *queens, *king;
-	int dir;
-	if( player == ME )
-		{
-		pawns	= &oppPawns;
-		rooks	= &oppRooks;
-		knights = &oppKnights;
-		bishops = &oppBishops;
-		queens	= &oppQueens;
-		king	= &oppKing;
-		allMy	= myPawns | myKnights | myBishops | myRooks | myQueens | myKing;
-		allOpp	= oppPawns | oppKnights | oppBishops | oppRooks | oppQueens | oppKing;
-		dir		= ( color == BLACK ? -1 : 1 );
+	int player = turn;
+	int side = sideColor( player );
+	int from = ACTION_FROM( action );
+	int to = ACTION_TO( action );
+	int flags = ACTION_FLAGS( action );
+	int dir = ( side == BLACK ? -8 : 8 );
+	PieceType piece = ACTION_PIECE( action );
+	Bitboard all = sidePieces( ME ) | sidePieces( OPPONENT );
+	Bitboard targets;
+
+	if( action == NULL_ACTION || piece >= NO_PIECE || !( pieces[ player ][ piece ] & BIT( from ) ) )
+		{
+		return false;
 		}
-	else
+
+	// The target square must hold what the flags say
+	if( flags == EN_PASSANT )
 		{
-		pawns	= &myPawns;
-		rooks	= &myRooks;
-		knights = &myKnights;
-		bishops = &myBishops;
-		queens	= &myQueens;
-		king	= &myKing;
-		allMy	= oppPawns | oppKnights | oppBishops | oppRooks | oppQueens | oppKing;
-		allOpp	= myPawns | myKnights | myBishops | myRooks | myQueens | myKing;
-		dir		= ( color == WHITE ? -1 : 1 );
+		if( piece != PAWN || to != epSquare || ACTION_CAPTURED( action ) != PAWN )
+			return false;
 		}
-	Bitboard all = allMy | allOpp;
-	all.reset( idx );
-	allMy.reset( from_idx );
-	allMy.set( to_idx );
-	allOpp.reset( to_idx );
+	else if( flags & CAPTURE )
+		{
+		if( ACTION_CAPTURED( action ) == NO_PIECE || pieceAt( !player, to ) != ACTION_CAPTURED( action ) )
+			return false;
+		}
+	else if( ( all & BIT( to ) ) || ACTION_CAPTURED( action ) != NO_PIECE )
+		{
+		return false;
+		}
+
+	// Pieces other than pawns only move or capture, plus
+	// the two castles for the king
+	if( piece != PAWN && flags != QUIET && flags != CAPTURE &&
+		!( piece == KING && ( flags == KING_CASTLE || flags == QUEEN_CASTLE ) ) )
+		{
+		return false;
+		}
+
+	// And the piece must be able to reach it
+	switch( piece )
+		{
+		case PAWN:
+			if( ( ( flags & PROMOTION ) != 0 ) != ( ( BIT( to ) & PROMOTION_RANKS ) != 0 ) )
+				return false;
+			if( flags == CAPTURE || flags == EN_PASSANT || ( flags & ~0x3 ) == ( CAPTURE | PROMOTION ) )
+				targets = pawnAttacks[ side ][ from ];
+			else if( flags == QUIET || ( flags & ~0x3 ) == PROMOTION )
+				targets = BIT( from + dir );
+			else if( flags == DOUBLE_PUSH && getRankNum( from ) == ( side == BLACK ? 6 : 1 ) && !( all & BIT( from + dir ) ) )
+				targets = BIT( from + dir + dir );
+			else
+				return false;
+			break;
+		case KING:
+			if( flags == KING_CASTLE || flags == QUEEN_CASTLE )
+				{
+				if( from != ( side == WHITE ? 4 : 60 ) || to != from + ( flags == KING_CASTLE ? 2 : -2 ) || !canCastle( flags ) )
+					return false;
+				targets = BIT( to );
+				}
+			else
+				targets = kingAttacks[ from ];
+			break;
+		case KNIGHT:
+			targets = knightAttacks[ from ];
+			break;
+		case BISHOP:
+			targets = bishopAttacks( from, all );
+			break;
+		case ROOK:
+			targets = rookAttacks( from, all );
+			break;
+		default:
+			targets = queenAttacks( from, all );
+			break;
+		}
+	if( !( targets & BIT( to ) ) )
+		{
+		return false;
+		}
+
+	return isLegal( action );
+	}
+
+
+/******************************************************
+* Attackers To Square
+* Returns every piece of either side attacking idx,
+* with sliders traced through the given occupancy so
+* that pieces removed from it reveal the ones behind.
+* isThreatened() answers the narrower legality question
+* and stays separate, since it can stop at the first
+* attacker it finds.
+******************************************************/
+Bitboard Chess::State::attackersTo( int idx, Bitboard occ ) const
+	{
+	Bitboard diagonal = pieces[ ME ][ BISHOP ] | pieces[ OPPONENT ][ BISHOP ] | pieces[ ME ][ QUEEN ] | pieces[ OPPONENT ][ QUEEN ];
+	Bitboard straight = pieces[ ME ][ ROOK ] | pieces[ OPPONENT ][ ROOK ] | pieces[ ME ][ QUEEN ] | pieces[ OPPONENT ][ QUEEN ];
+
+	return( ( pieces[ ME ][ PAWN ] & pawnAttacks[ sideColor( OPPONENT ) ][ idx ] ) |
+			( pieces[ OPPONENT ][ PAWN ] & pawnAttacks[ sideColor( ME ) ][ idx ] ) |
+			( ( pieces[ ME ][ KNIGHT ] | pieces[ OPPONENT ][ KNIGHT ] ) & knightAttacks[ idx ] ) |
+			( ( pieces[ ME ][ KING ] | pieces[ OPPONENT ][ KING ] ) & kingAttacks[ idx ] ) |
+			( diagonal & bishopAttacks( idx, occ ) ) |
+			( straight & rookAttacks( idx, occ ) ) );
+	}
+
 
+/******************************************************
+* Static Exchange Evaluation
+* Material the side to move wins by playing action,
+* assuming both sides keep recapturing on the target
+* square with their least valuable attacker for as
+* long as it pays. Quiet moves are scored as if the
+* piece could be captured where it lands.
+******************************************************/
+int Chess::State::see( Action action ) const
+	{
+	int from = ACTION_FROM( action );
+	int to = ACTION_TO( action );
+	int player = turn;
+	int gain[ 32 ];
+	int d = 0;
 	int i;
+	Bitboard occ = sidePieces( ME ) | sidePieces( OPPONENT );
+	Bitboard attackers, mine;
+	PieceType attacker = ACTION_PIECE( action );
+
+	gain[ 0 ] = pieceValue( ACTION_CAPTURED( action ) );
+	if( IS_PROMOTION( action ) )
+		{
+		attacker = PROMOTION_PIECE( action );
+		gain[ 0 ] += pieceValue( attacker ) - pieceValue( PAWN );
+		}
+	occ ^= BIT( from );
+	if( ACTION_FLAGS( action ) == EN_PASSANT )
+		{
+		occ ^= BIT( ( from & ~7 ) | ( to & 7 ) );
+		}
+
+	// Swap off attackers, lowest value first. Each entry is
+	// the gain if the exchange were to stop there.
+	attackers = attackersTo( to, occ ) & occ;
+	while( true )
+		{
+		player = !player;
+		mine = attackers & sidePieces( player );
+		if( !mine )
+			break;
+		for( i = 0; !( mine & pieces[ player ][ seeOrder[ i ] ] ); i++ );
+
+		// The king can only recapture onto an undefended square
+		if( seeOrder[ i ] == KING && ( attackers & sidePieces( !player ) ) )
+			break;
+
+		d++;
+		gain[ d ] = pieceValue( attacker ) - gain[ d - 1 ];
+		attacker = seeOrder[ i ];
+		occ ^= BIT( lsb( mine & pieces[ player ][ attacker ] ) );
+		attackers = attackersTo( to, occ ) & occ;
+		}
+
+	// Either side may decline to recapture
+	while( d > 0 )
+		{
+		gain[ d - 1 ] = -std::max( -gain[ d - 1 ], gain[ d ] );
+		d--;
+		}
+	return gain[ 0 ];
+	}
+
+
+/******************************************************
+* Test if index is Threatened
+* If square is under attack by the other side, returns
+* the index of the square found to be attacking it
+******************************************************/
+int Chess::State::isThreatened( int idx, int player )
+	{
+	const Bitboard* theirs = pieces[ !player ];
+	Bitboard all = sidePieces( ME ) | sidePieces( OPPONENT );
+	Bitboard attackers;
 
 	// Check for attacking pawns
-	pieces = *pawns;
-	//pieces.reset( to_idx );
-	if( isValidIdx( idx + ( 7 * dir ) ) && pieces.test( idx + ( 7 * dir ) ) && !oneRowCross( idx, idx + ( 7 * dir ) ) )
-		return idx + ( 7 * dir );
-	if( isValidIdx( idx + ( 9 * dir ) ) && pieces.test( idx + ( 9 * dir ) ) && !oneRowCross( idx, idx + ( 9 * dir ) ) )
-		return idx + ( 9 * dir );
+	attackers = theirs[ PAWN ] & pawnAttacks[ sideColor( player ) ][ idx ];
+	if( attackers ) return lsb( attackers );
 
 	// Check for attacking bishops or queens (diagonally)
-	pieces = *bishops | *queens;
-	//pieces.reset( to_idx );
-	for( i = idx; ( isValidIdx( i + 9 ) && !testIdx( all, i ) && ( getFileNum( i ) != 7 ) ); i += 9 ) {};
-	if( pieces.test( i ) ) return i;
-	for( i = idx; ( isValidIdx( i - 9 ) && !testIdx( all, i ) && ( getFileNum( i ) != 0 ) ); i -= 9 ) {};
-	if( pieces.test( i ) ) return i;
-	for( i = idx; ( isValidIdx( i + 7 ) && !testIdx( all, i ) && ( getFileNum( i ) != 0 ) ); i += 7 ) {};
-	if( pieces.test( i ) ) return i;
-	for( i = idx; ( isValidIdx( i - 7 ) && !testIdx( all, i ) && ( getFileNum( i ) != 7 ) ); i -= 7 ) {};
-	if( pieces.test( i ) ) return i;
+	attackers = ( theirs[ BISHOP ] | theirs[ QUEEN ] ) & bishopAttacks( idx, all );
+	if( attackers ) return lsb( attackers );
 
 	// Check for attacking rooks or queens (obliques)
-	pieces = *rooks | *queens;
-	//pieces.reset( to_idx );
-	for( i = idx; ( isValidIdx( i + 8 ) && !all.test( i ) ); i += 8 ) {};
-	if( pieces.test( i ) ) return i;
-	for( i = idx; ( isValidIdx( i - 8 ) && !all.test( i ) ); i -= 8 ) {};
-	if( pieces.test( i ) ) return i;
-	for( i = idx; ( isValidIdx( i + 1 ) && !all.test( i ) ) && inSameRow( idx, i + 1 ); i += 1 ) {};
-	if( pieces.test( i ) ) return i;
-	for( i = idx; ( isValidIdx( i - 1 ) && !all.test( i ) ) && inSameRow( idx, i - 1 ); i -= 1 ) {};
-	if( pieces.test( i ) ) return i;
+	attackers = ( theirs[ ROOK ] | theirs[ QUEEN ] ) & rookAttacks( idx, all );
+	if( attackers ) return lsb( attackers );
 
 	// Check for attacking knights
-	pieces = *knights;
-	//pieces.reset( to_idx );
-	int new_idx;
-	for( i = 0; i < 8; i++ )
-		{
-		new_idx = idx + knightMoves[ i ];
-		if( isValidIdx( new_idx ) && pieces.test( new_idx ) && !twoRowCross( idx, new_idx ) )
-			return new_idx;
-		}
+	attackers = theirs[ KNIGHT ] & knightAttacks[ idx ];
+	if( attackers ) return lsb( attackers );
 
 	// Check for attacking kings (yes, I guess that is a thing...)
-	pieces = *king;
-	//pieces.reset( to_idx );
-	for( i = 0; i < 8; i++ )
-		{
-		new_idx = idx + kingMoves[ i ];
-		if( isValidIdx( new_idx ) && pieces.test( new_idx ) && !oneRowCross( idx, new_idx ) )
-			return new_idx;
-		}
+	attackers = theirs[ KING ] & kingAttacks[ idx ];
+	if( attackers ) return lsb( attackers );
 
 	return NOT_THREATENED;
 	}
 
 
+/**************************************************************
+* Is Repetition?
+* True if playing the passed action would repeat the four
+* moves that came before the last four
+**************************************************************/
+bool Chess::State::isRepetition( Action action )
+	{
+	if( ply < 7 )
+		{
+		return false;
+		}
+	return( ( action & SQUARES_MASK ) == ( undoStack[ ply - 4 ].action & SQUARES_MASK ) &&
+			( undoStack[ ply - 1 ].action & SQUARES_MASK ) == ( undoStack[ ply - 5 ].action & SQUARES_MASK ) &&
+			( undoStack[ ply - 2 ].action & SQUARES_MASK ) == ( undoStack[ ply - 6 ].action & SQUARES_MASK ) &&
+			( undoStack[ ply - 3 ].action & SQUARES_MASK ) == ( undoStack[ ply - 7 ].action & SQUARES_MASK ) );
+	}
+
+
 /**************************************************************
 * Validate & Add Move
 * Checks to see if this move would violate any higher order rules
-* such as check or repetition and performs alterations to 
-* produce a child state and add to passed vector.
+* and adds it to passed vector. The generator's check and pin
+* masks already keep the king safe, so only repetition is tested,
+* except for en passant: taking two pawns off one rank can expose
+* the king in a way the pin masks don't see.
 **************************************************************/
-void Chess::State::addMove( std::vector<Chess::State*>& frontier, int from_idx, int to_idx, Bitboard* piece, int player )
+void Chess::State::addMove( ActionList& frontier, int from_idx, int to_idx, int flags, PieceType piece )
 	{
+	int player = turn;
 	if( DEBUG_PRINT ) std::cout << "Testing move from " << from_idx << " to " << to_idx << ":   ";
 
-	// Apply move, copy state, revert move
-	piece->set( to_idx );
-	piece->reset( from_idx );
-	Chess::State* newState = new State( this );
-	piece->reset( to_idx );
-	piece->set( from_idx );
-
-	// Set to/from indices in misc data struct
-	newState->misc &= ( Bitboard )CASTLE_MASK;
-	newState->misc |= ( ( ( unsigned long long )from_idx ) << FROMIDX_BITSHIFT );
-	newState->misc |= ( ( ( unsigned long long )to_idx ) << TOIDX_BITSHIFT );
-	//if( DEBUG_PRINT ) std::cout << newState->misc << std::endl;
-	
-	// My side processing
-	if( player == ME )
-		{
-		// Remove piece that was attacked
-		newState->oppPawns.reset( to_idx );
-		newState->oppRooks.reset( to_idx );
-		newState->oppKnights.reset( to_idx );
-		newState->oppBishops.reset( to_idx );
-		newState->oppQueens.reset( to_idx );
-		newState->oppKing.reset( to_idx );
-		// Special case for pawn promotion (always promotes to queen)
-		if( ( piece == &myPawns ) && ( to_idx > 55 || to_idx < 8 ) )
-			{
-			newState->myQueens.set( to_idx );
-			newState->myPawns.reset( to_idx );
-			}
-		}
-	// Opponent's side processing
-	else
+	PieceType captured = NO_PIECE;
+	if( flags == EN_PASSANT )
+		captured = PAWN;
+	else if( flags & CAPTURE )
+		captured = pieceAt( !player, to_idx );
+	Action action = ACTION( from_idx, to_idx, flags, piece, captured );
+
+	if( flags == EN_PASSANT ? isLegal( action ) : !isRepetition( action ) )
 		{
-		// Remove piece that was attacked
-		newState->myPawns.reset( to_idx );
-		newState->myRooks.reset( to_idx );
-		newState->myKnights.reset( to_idx );
-		newState->myBishops.reset( to_idx );
-		newState->myQueens.reset( to_idx );
-		newState->myKing.reset( to_idx );
-		// Special case for pawn promotion (always promotes to queen)
-		if( ( piece == &oppPawns ) && ( to_idx > 55 || to_idx < 8 ) )
-			{
-			newState->oppQueens.set( to_idx );
-			newState->oppPawns.reset( to_idx );
-			}
+		frontier.push( action );
 		}
-	// Special case for double pawn step (makes en passant possible)
-	int i = std::abs( from_idx - to_idx );
-	if( ( piece == &myPawns || piece == &oppPawns ) && i == 16 )
-		newState->misc.set( i / 2 );
+
+	return;
+	}
+
+
+/******************************************************
+* Is Legal Action
+* Rejects moves that would cause a repetition or leave
+* the mover's own king in check
+******************************************************/
+bool Chess::State::isLegal( Action action )
+	{
+	int player = turn;
 
 	// see if this move would cause repetition
-	bool repetition = true;
-	Chess::State* runner = newState;
-	Chess::State* runner2 = newState;
-	for( i = 0; i < 4; i++ )
-		{
-		if( runner2->parent == nullptr )
-			{
-			repetition = false;
-			break;
-			}
-		runner2 = runner2->parent;
-		}
-	int toIdx, fromIdx, toIdx2, fromIdx2;
-	for( i = 0; i < 4 && repetition; i++ )
-		{
-		int toIdx = ( runner->misc.to_ullong() & TOIDX_MASK ) >> TOIDX_BITSHIFT;
-		int fromIdx = ( runner->misc.to_ullong() & FROMIDX_MASK ) >> FROMIDX_BITSHIFT;
-		int toIdx2 = ( runner2->misc.to_ullong() & TOIDX_MASK ) >> TOIDX_BITSHIFT;
-		int fromIdx2 = ( runner2->misc.to_ullong() & FROMIDX_MASK ) >> FROMIDX_BITSHIFT;
-		if( toIdx != toIdx2 || fromIdx != fromIdx2 )
-			{
-			repetition = false;
-			break;
-			}
-		if( runner2->parent == nullptr )
-			{
-			repetition = false;
-			break;
-			}
-		runner = runner->parent;
-		runner2 = runner2->parent;
-		}
-	if( repetition )
+	if( isRepetition( action ) )
 		{
 		if( DEBUG_PRINT ) std::cout << "Would cause repetition!" << std::endl;
-		return;
+		return false;
 		}
 	
 	// Check if the king is in check
-	int kingIdx = ( ( player == ME ) ? bitScanForward( newState->myKing ) : bitScanForward( newState->oppKing ) );
-	int test = newState->isThreatened( kingIdx, to_idx, from_idx, player );
+	makeMove( action );
+	int test = isThreatened( lsb( pieces[ player ][ KING ] ), player );
+	unmakeMove();
 	if( test != NOT_THREATENED )
 		{
 		if( DEBUG_PRINT ) std::cout << "Puts King in check from idx: " << test << std::endl;
-		piece->reset( to_idx );
-		piece->set( from_idx );
-		return;
+		return false;
 		}
 	
 	// If we made it this far, the move is valid
 	if( DEBUG_PRINT ) std::cout << "Is valid!" << std::endl;
-	newState->calcScore();
-	frontier.push_back( newState );
+	return true;
+	}
+
 
+/**************************************************************
+* Add Pawn Move
+* Expands a pawn move onto the last rank into one move per
+* promotion piece
+**************************************************************/
+void Chess::State::addPawnMove( ActionList& frontier, int from_idx, int to_idx, int flags )
+	{
+	if( BIT( to_idx ) & PROMOTION_RANKS )
+		{
+		for( int i = 3; i >= 0; i-- )
+			{
+			addMove( frontier, from_idx, to_idx, flags | PROMOTION | i, PAWN );
+			}
+		}
+	else
+		{
+		addMove( frontier, from_idx, to_idx, flags, PAWN );
+		}
 	return;
 	}
 
 
 /**************************************************************
-* Calculate Score
-* Hueristic evaluation function
+* Make Move
+* Applies the passed action to this state in place, pushing
+* everything needed to reverse it onto the undo stack
 **************************************************************/
-void Chess::State::calcScore()
+void Chess::State::makeMove( Action action )
 	{
-	Bitboard pawns = myPawns;
-	int idx, i, pawnsInFile;
+	int player			= turn;
+	Bitboard* mine		= pieces[ player ];
+	Bitboard* theirs	= pieces[ !player ];
+	int from_idx		= ACTION_FROM( action );
+	int to_idx			= ACTION_TO( action );
+	int flags			= ACTION_FLAGS( action );
+	int moved			= ACTION_PIECE( action );
+	int side			= sideColor( player );
+	int captured_idx;
+
+	Undo& undo		= undoStack[ ply++ ];
+	undo.action		= action;
+	undo.key		= key;
+	undo.pawnKey	= pawnKey;
+	undo.epSquare	= epSquare;
+	undo.castling	= castling;
+	undo.material[ 0 ]	= material[ 0 ];
+	undo.material[ 1 ]	= material[ 1 ];
+	undo.psq[ 0 ]		= psq[ 0 ];
+	undo.psq[ 1 ]		= psq[ 1 ];
+
+	key ^= sideKey;
+	if( epSquare != NO_SQUARE )
+		key ^= epKeys[ getFileNum( epSquare ) ];
+
+	// Remove piece that was attacked
+	if( flags == EN_PASSANT )
+		{
+		captured_idx = to_idx + ( side == WHITE ? -8 : 8 );
+		theirs[ PAWN ] &= ~BIT( captured_idx );
+		key ^= pieceKeys[ !side ][ PAWN ][ captured_idx ];
+		pawnKey ^= pieceKeys[ !side ][ PAWN ][ captured_idx ];
+		material[ !player ] -= pawnVal;
+		psq[ !player ] -= squareValue( !side, PAWN, captured_idx );
+		}
+	else if( flags & CAPTURE )
+		{
+		theirs[ ACTION_CAPTURED( action ) ] &= ~BIT( to_idx );
+		key ^= pieceKeys[ !side ][ ACTION_CAPTURED( action ) ][ to_idx ];
+		if( ACTION_CAPTURED( action ) == PAWN )
+			pawnKey ^= pieceKeys[ !side ][ PAWN ][ to_idx ];
+		material[ !player ] -= pieceValue( ACTION_CAPTURED( action ) );
+		psq[ !player ] -= squareValue( !side, ACTION_CAPTURED( action ), to_idx );
+		}
+
+	// Move the piece, plus the rook if castling
+	mine[ moved ] ^= BIT( from_idx ) | BIT( to_idx );
+	key ^= pieceKeys[ side ][ moved ][ from_idx ] ^ pieceKeys[ side ][ moved ][ to_idx ];
+	psq[ player ] += squareValue( side, moved, to_idx ) - squareValue( side, moved, from_idx );
+	if( moved == PAWN )
+		pawnKey ^= pieceKeys[ side ][ PAWN ][ from_idx ] ^ pieceKeys[ side ][ PAWN ][ to_idx ];
+	if( flags & PROMOTION )
+		{
+		mine[ PAWN ] &= ~BIT( to_idx );
+		mine[ PROMOTION_PIECE( action ) ] |= BIT( to_idx );
+		key ^= pieceKeys[ side ][ PAWN ][ to_idx ] ^ pieceKeys[ side ][ PROMOTION_PIECE( action ) ][ to_idx ];
+		pawnKey ^= pieceKeys[ side ][ PAWN ][ to_idx ];
+		material[ player ] += pieceValue( PROMOTION_PIECE( action ) ) - pawnVal;
+		psq[ player ] += squareValue( side, PROMOTION_PIECE( action ), to_idx ) - squareValue( side, PAWN, to_idx );
+		}
+	else if( flags == KING_CASTLE )
+		{
+		mine[ ROOK ] ^= BIT( to_idx + 1 ) | BIT( to_idx - 1 );
+		key ^= pieceKeys[ side ][ ROOK ][ to_idx + 1 ] ^ pieceKeys[ side ][ ROOK ][ to_idx - 1 ];
+		psq[ player ] += squareValue( side, ROOK, to_idx - 1 ) - squareValue( side, ROOK, to_idx + 1 );
+		}
+	else if( flags == QUEEN_CASTLE )
+		{
+		mine[ ROOK ] ^= BIT( to_idx - 2 ) | BIT( to_idx + 1 );
+		key ^= pieceKeys[ side ][ ROOK ][ to_idx - 2 ] ^ pieceKeys[ side ][ ROOK ][ to_idx + 1 ];
+		psq[ player ] += squareValue( side, ROOK, to_idx + 1 ) - squareValue( side, ROOK, to_idx - 2 );
+		}
+
+	// Special case for double pawn step (makes en passant possible)
+	key ^= castlingKeys[ castling ];
+	castling &= castleMasks[ from_idx ] & castleMasks[ to_idx ];
+	key ^= castlingKeys[ castling ];
+	epSquare = ( flags == DOUBLE_PUSH ? ( from_idx + to_idx ) / 2 : NO_SQUARE );
+	if( epSquare != NO_SQUARE )
+		key ^= epKeys[ getFileNum( epSquare ) ];
+	turn = !player;
+
+	return;
+	}
 
-	Bitboard allMy = myPawns | myKnights | myBishops | myRooks | myQueens | myKing;
-	Bitboard allOpp = oppPawns | oppKnights | oppBishops | oppRooks | oppQueens | oppKing;
-	Bitboard all = allMy | allOpp;
-	int dir = ( color == BLACK ? -1 : 1 );
 
-	// Evaluate pwn structure
-	int blockedPawns = 0;
-	int doubledPawns = 0;
-	int isolatedPawns = 0;
-	while( ( idx = bitScanForward( pawns ) ) != -1 )
+/**************************************************************
+* Unmake Move
+* Pops the last action off of the undo stack and restores the
+* state to exactly what it was before makeMove()
+**************************************************************/
+void Chess::State::unmakeMove()
+	{
+	int player			= turn = !turn;
+	Undo& undo			= undoStack[ --ply ];
+	Bitboard* mine		= pieces[ player ];
+	Bitboard* theirs	= pieces[ !player ];
+	int from_idx		= ACTION_FROM( undo.action );
+	int to_idx			= ACTION_TO( undo.action );
+	int flags			= ACTION_FLAGS( undo.action );
+
+	// Put the piece (and rook) back
+	if( flags & PROMOTION )
+		{
+		mine[ PROMOTION_PIECE( undo.action ) ] &= ~BIT( to_idx );
+		mine[ PAWN ] |= BIT( to_idx );
+		}
+	else if( flags == KING_CASTLE )
+		{
+		mine[ ROOK ] ^= BIT( to_idx + 1 ) | BIT( to_idx - 1 );
+		}
+	else if( flags == QUEEN_CASTLE )
 		{
-		pawns.reset( idx );
+		mine[ ROOK ] ^= BIT( to_idx - 2 ) | BIT( to_idx + 1 );
+		}
+	mine[ ACTION_PIECE( undo.action ) ] ^= BIT( from_idx ) | BIT( to_idx );
 
-		//Check is pawn is blocked
-		if( testIdx( all, idx + ( dir * 8 ) ) )
-			blockedPawns++;
+	// Restore captured piece
+	if( flags == EN_PASSANT )
+		{
+		theirs[ PAWN ] |= BIT( to_idx + ( sideColor( player ) == WHITE ? -8 : 8 ) );
+		}
+	else if( flags & CAPTURE )
+		{
+		theirs[ ACTION_CAPTURED( undo.action ) ] |= BIT( to_idx );
+		}
 
-		// Check if pawn is doubled
-		pawnsInFile = 0;
-		for( i = getFileNum( idx ); i <= 63; i += 8 )
-			{
-			if( myPawns.test( i ) )
-				pawnsInFile++;
-			}
-		if( pawnsInFile > 1 )
-			doubledPawns++;
+	castling = undo.castling;
+	epSquare = undo.epSquare;
+	key = undo.key;
+	pawnKey = undo.pawnKey;
+	material[ 0 ] = undo.material[ 0 ];
+	material[ 1 ] = undo.material[ 1 ];
+	psq[ 0 ] = undo.psq[ 0 ];
+	psq[ 1 ] = undo.psq[ 1 ];
+	return;
+	}
 
-		// Check if pawn is isolated
-		pawnsInFile = 0;
-		i = getFileNum( idx );
-		if( i != 0 )
-			{
-			for( i - 1; i <= 63; i += 8 )
-				{
-				if( myPawns.test( i ) )
-					pawnsInFile++;
-				}
-			}
-		if( i != 7 && pawnsInFile == 0 )
-			{
-			for( i + 1; i <= 63; i += 8 )
-				{
-				if( myPawns.test( i ) )
-					pawnsInFile++;
-				}
-			}
-		if( pawnsInFile == 0 )
-			isolatedPawns++;
+
+/**************************************************************
+* Make Null Move
+* Passes the turn without moving a piece. Used by null move
+* pruning; must be undone with unmakeNullMove().
+**************************************************************/
+void Chess::State::makeNullMove()
+	{
+	Undo& undo		= undoStack[ ply++ ];
+	undo.action		= NULL_ACTION;
+	undo.key		= key;
+	undo.epSquare	= epSquare;
+	undo.castling	= castling;
+
+	key ^= sideKey;
+	if( epSquare != NO_SQUARE )
+		key ^= epKeys[ getFileNum( epSquare ) ];
+	epSquare = NO_SQUARE;
+	turn = !turn;
+	return;
 	}
 
-	// Add piece values to score
-	int pieceValScore = 0;
-	pieceValScore += kingVal * ( myKing.count() - oppKing.count() );
-	pieceValScore += queenVal * ( myQueens.count() - oppQueens.count() );
-	pieceValScore += rookVal * ( myRooks.count() - oppRooks.count() );
-	pieceValScore += knightVal * ( myKnights.count() - oppKnights.count() );
-	pieceValScore += bishopVal * ( myBishops.count() - oppBishops.count() );
-	pieceValScore += pawnVal * ( myPawns.count() - oppPawns.count() );
-	pieceValScore -= pawnPenalty * ( blockedPawns + doubledPawns + isolatedPawns );
-
-	// Calculate board position values (piece-square value)
-	Bitboard* myBitboards[ 6 ]{ &myPawns, &myRooks, &myKnights, &myBishops, &myQueens, &myKing };
-	Bitboard pieces;
-	int pieceSquareScore = 0;
-	for( i = 0; i < 6; i++ )
+
+/**************************************************************
+* Unmake Null Move
+* Takes back the last makeNullMove()
+**************************************************************/
+void Chess::State::unmakeNullMove()
+	{
+	Undo& undo	= undoStack[ --ply ];
+	epSquare	= undo.epSquare;
+	key			= undo.key;
+	turn		= !turn;
+	return;
+	}
+
+
+/**************************************************************
+* Pawn Structure
+* Looks up the cached pawn terms for the current pawns,
+* evaluating them first if the slot holds another structure
+**************************************************************/
+const PawnEntry* Chess::State::pawnStructure() const
+	{
+	PawnEntry* entry = probePawnTable( pawnKey );
+	if( entry->key != pawnKey )
+		{
+		evalPawns( entry );
+		}
+	return entry;
+	}
+
+
+/**************************************************************
+* Evaluate Pawns
+* Fills in entry with the pawn structure of both players. Every
+* mask is built for all pawns at once from file fills and
+* shifts:
+*   doubled   another friendly pawn on the same file
+*   isolated  no friendly pawn on either neighbouring file
+*   backward  stop square taken by an enemy pawn's attack and
+*             no friendly pawn on a neighbouring file able to
+*             come up and cover it
+*   passed    no enemy pawn ahead on the same or a neighbouring
+*             file, and no friendly pawn ahead on the same file
+**************************************************************/
+void Chess::State::evalPawns( PawnEntry* entry ) const
+	{
+	Bitboard ours, theirs, ourSpan, theirFront, ourAttacks, theirAttacks, passed;
+	int player, side, idx, rank, weak;
+
+	for( player = ME; player <= OPPONENT; player++ )
+		{
+		side			= sideColor( player );
+		ours			= pieces[ player ][ PAWN ];
+		theirs			= pieces[ !player ][ PAWN ];
+		ourSpan			= fileFill( ours );
+		theirFront		= pawnPush( rearFill( theirs, side ), side ^ 1 );
+		theirFront		|= shiftEast( theirFront ) | shiftWest( theirFront );
+		ourAttacks		= shiftEast( pawnPush( ours, side ) ) | shiftWest( pawnPush( ours, side ) );
+		theirAttacks	= shiftEast( pawnPush( theirs, side ^ 1 ) ) | shiftWest( pawnPush( theirs, side ^ 1 ) );
+
+		entry->doubled[ side ]	= ours & ( pawnPush( frontFill( ours, side ), side ) | pawnPush( rearFill( ours, side ), side ^ 1 ) );
+		entry->isolated[ side ]	= ours & ~( shiftEast( ourSpan ) | shiftWest( ourSpan ) );
+		entry->backward[ side ]	= pawnPush( pawnPush( ours, side ) & theirAttacks & ~frontFill( ourAttacks, side ), side ^ 1 ) &
+								  ~entry->isolated[ side ];
+		entry->passed[ side ]	= ours & ~theirFront & ~pawnPush( rearFill( ours, side ), side ^ 1 );
+
+		weak = popCount( entry->doubled[ side ] ) + popCount( entry->isolated[ side ] ) + popCount( entry->backward[ side ] );
+		entry->score[ side ] = MAKE_SCORE( -pawnPenalty * weak, -pawnPenalty * weak );
+		passed = entry->passed[ side ];
+		while( passed )
+			{
+			idx = popLsb( passed );
+			rank = getRankNum( idx );
+			entry->score[ side ] += passedPawnBonus[ side == WHITE ? rank : 7 - rank ];
+			}
+		}
+	entry->key = pawnKey;
+	return;
+	}
+
+
+/**************************************************************
+* Evaluate Activity
+* Builds each player's attack map once, one piece at a time,
+* and scores from it:
+*   mobility   squares each piece attacks that are neither
+*              ours nor covered by an enemy pawn
+*   king zone  pressure on the squares around the enemy king,
+*              once enough pieces take part
+*   hanging    pieces attacked and not defended, or attacked
+*              by a pawn
+* Returns a packed Score from our point of view.
+**************************************************************/
+Score Chess::State::evalActivity() const
+	{
+	Bitboard all = sidePieces( ME ) | sidePieces( OPPONENT );
+	Bitboard pawnAttacked[ 2 ], attacked[ 2 ];
+	Bitboard mobilityArea, kingZone, board, targets;
+	int mobility[ 2 ], kingDanger[ 2 ], hanging[ 2 ];
+	int player, piece, attackers, weight, common;
+	const int kingZoneWeights[ 6 ] = { 0, kingZoneRook, kingZoneKnight, kingZoneBishop, kingZoneQueen, 0 };
+
+	for( player = ME; player <= OPPONENT; player++ )
+		{
+		board = pawnPush( pieces[ player ][ PAWN ], sideColor( player ) );
+		pawnAttacked[ player ] = shiftEast( board ) | shiftWest( board );
+		}
+
+	for( player = ME; player <= OPPONENT; player++ )
+		{
+		mobilityArea		= ~sidePieces( player ) & ~pawnAttacked[ !player ];
+		kingZone			= kingAttacks[ lsb( pieces[ !player ][ KING ] ) ];
+		attacked[ player ]	= pawnAttacked[ player ] | kingAttacks[ lsb( pieces[ player ][ KING ] ) ];
+		mobility[ player ]	= 0;
+		attackers			= 0;
+		weight				= 0;
+		for( piece = ROOK; piece <= QUEEN; piece++ )
+			{
+			board = pieces[ player ][ piece ];
+			while( board )
+				{
+				targets = pieceAttacks( piece, popLsb( board ), all );
+				attacked[ player ] |= targets;
+				mobility[ player ] += popCount( targets & mobilityArea );
+				if( targets & kingZone )
+					{
+					attackers++;
+					weight += kingZoneWeights[ piece ] * popCount( targets & kingZone );
+					}
+				}
+			}
+		kingDanger[ !player ] = ( attackers >= kingAttackersMin ? weight * attackers / 2 : 0 );
+		}
+
+	for( player = ME; player <= OPPONENT; player++ )
+		{
+		board = sidePieces( player ) & ~pieces[ player ][ KING ];
+		hanging[ player ] = popCount( ( board & attacked[ !player ] & ~attacked[ player ] ) |
+									  ( board & ~pieces[ player ][ PAWN ] & pawnAttacked[ !player ] ) );
+		}
+
+	// King safety only matters while there are pieces left
+	// to attack with, so it only goes in the midgame half
+	common = mobPenalty * ( mobility[ ME ] - mobility[ OPPONENT ] ) - hangingPenalty * ( hanging[ ME ] - hanging[ OPPONENT ] );
+	return MAKE_SCORE( common - ( kingDanger[ ME ] - kingDanger[ OPPONENT ] ), common );
+	}
+
+
+/**************************************************************
+* Calculate Score
+* Hueristic evaluation function
+**************************************************************/
+void Chess::State::calcScore()
+	{
+	Bitboard all = sidePieces( ME ) | sidePieces( OPPONENT );
+	const PawnEntry* pawnEntry = pawnStructure();
+
+	// Blocked pawns depend on every piece, not just the
+	// pawns, so they are counted here instead of cached
+	int blockedPawns = popCount( pawnPush( pieces[ ME ][ PAWN ], sideColor( ME ) ) & all ) -
+					   popCount( pawnPush( pieces[ OPPONENT ][ PAWN ], sideColor( OPPONENT ) ) & all );
+
+	// Cross-check the running material and piece-square
+	// terms and the pawn key against a full recompute
+	if( DEBUG_EVAL )
 		{
-		pieces = *myBitboards[ i ];
-		while( ( idx = bitScanForward( pieces ) ) != -1 )
-			{
-			pieces.reset( idx );
-			if( color == WHITE )
-				idx = 63 - idx;
-			pieceSquareScore += ( squareVals[ i ] )[ idx ];
-			}
+		int checkMaterial[ 2 ];
+		Score checkPsq[ 2 ];
+		computeEval( checkMaterial, checkPsq );
+		if( checkMaterial[ ME ] != material[ ME ] || checkMaterial[ OPPONENT ] != material[ OPPONENT ] ||
+			checkPsq[ ME ] != psq[ ME ] || checkPsq[ OPPONENT ] != psq[ OPPONENT ] ||
+			computePawnKey() != pawnKey )
+			std::cout << "Evaluation terms out of sync at ply " << ply << std::endl;
 		}
+
+	// Add piece values to score
+	int pieceValScore = material[ ME ] - material[ OPPONENT ];
+	pieceValScore -= pawnPenalty * blockedPawns;
+
+	// Pawn structure and board position values (piece-square
+	// value) for both players, blended from the midgame
+	// toward the endgame as pieces come off the board
+	int phase = gamePhase();
+	int pawnScore = taper( pawnEntry->score[ sideColor( ME ) ] - pawnEntry->score[ sideColor( OPPONENT ) ], phase );
+	int pieceSquareScore = taper( psq[ ME ] - psq[ OPPONENT ], phase );
+
+	// Mobility, king safety and hanging pieces
+	int activityScore = taper( evalActivity(), phase );
 	
 	// Assign score
-	score = pieceValScore + (int)( 0.1 * (float)pieceSquareScore );
+	score = pieceValScore + pawnScore + activityScore + (int)( 0.1 * (float)pieceSquareScore );
 
 	return;
 	}
 
+
+/**************************************************************
+* Game Phase
+* Weighs the knights, bishops, rooks and queens left on the
+* board. Capped, so that extra promoted pieces still read as
+* the opening.
+**************************************************************/
+int Chess::State::gamePhase() const
+	{
+	int phase = 0;
+	for( int i = PAWN; i < KING; i++ )
+		{
+		phase += phaseWeights[ i ] * popCount( pieces[ ME ][ i ] | pieces[ OPPONENT ][ i ] );
+		}
+	return std::min( phase, PHASE_MAX );
+	}
+
 
+/**************************************************************
+* Evaluate
+* Scores the state from the point of view of the side to move
+**************************************************************/
+int Chess::State::evaluate()
+	{
+	calcScore();
+	return( turn == ME ? score : -score );
+	}
+
+
+/**************************************************************
+* Action To String
+* Formats an action as from and to squares, e.g. "e7 to e8=Q"
+**************************************************************/
+std::string actionToString( Action action )
+	{
+	static const char promotionChars[ 4 ] = { 'N', 'B', 'R', 'Q' };
+	int from_idx = ACTION_FROM( action );
+	int to_idx = ACTION_TO( action );
+	std::string str;
+	str += ( char )( ( from_idx % 8 ) + 'a' );
+	str += ( char )( ( from_idx / 8 ) + '1' );
+	str += " to ";
+	str += ( char )( ( to_idx % 8 ) + 'a' );
+	str += ( char )( ( to_idx / 8 ) + '1' );
+	if( IS_PROMOTION( action ) )
+		{
+		str += '=';
+		str += promotionChars[ ACTION_FLAGS( action ) & 0x3 ];
+		}
+	return str;
+	}
+
+
 /**************************************************************
 * Print Moves
-* Outputs all moves in passed vector to the console in a
+* Outputs all moves in passed list to the console in a
 * user-readable format
 **************************************************************/
-void printMoves( std::vector<Chess::State*>* moves )
+void printMoves( ActionList& moves )
 	{
-	std::vector<Chess::State*>::iterator it = moves->begin();
-	std::vector<Chess::State*>::iterator end = moves->end();
-	int toIdx, fromIdx;
 	std::cout << "Possible moves:" << std::endl;
-	for( it; it != end; it++ )
+	for( int i = 0; i < moves.size; i++ )
 		{
-		toIdx = ( ( *it )->misc.to_ullong() & TOIDX_MASK ) >> TOIDX_BITSHIFT;
-		fromIdx = ( ( *it )->misc.to_ullong() & FROMIDX_MASK ) >> FROMIDX_BITSHIFT;
-		std::cout << "  " << ( char )( ( fromIdx % 8 ) + 'a' ) << 1 + fromIdx / 8
-			<< " to " << ( char )( ( toIdx % 8 ) + 'a' ) << 1 + toIdx / 8
-			<< " S:" << ( *it )->score << std::endl;
+		std::cout << "  " << actionToString( moves[ i ].action ) << std::endl;
 		}
 	return;
 	}
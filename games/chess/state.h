@@ -11,134 +11,228 @@
 * Includes
 ******************************************************/
 #include "chess.h"
-#include "gameObject.h"
-#include <bitset>
-#include <boost/functional/hash.hpp>
+#include "bitboard.h"
+#include "zobrist.h"
+#include "score.h"
+#include "pawntable.h"
+#include <string>
+#include <vector>
 
 
 /******************************************************
 * Compiler Constants
 ******************************************************/
 #define DEBUG_PRINT			false
-#define TOIDX_BITSHIFT		24
-#define TOIDX_MASK			0x00000000FF000000
-#define FROMIDX_BITSHIFT	32
-#define FROMIDX_MASK		0x000000FF00000000
-#define EN_PASSANT_MASK		0x0000FF0000FF0000
-#define CASTLE_MASK			0x8100000000000081
+#define DEBUG_EVAL			false
+#define MAX_PLY				( 256 )
+#define NO_SQUARE			( -1 )
+#define NULL_ACTION			( 0 )
+
+// Castling rights
+#define WHITE_OO			( 0x1 )
+#define WHITE_OOO			( 0x2 )
+#define BLACK_OO			( 0x4 )
+#define BLACK_OOO			( 0x8 )
+
+#define MAX_ACTIONS			( 256 )
+
+// Move generation types
+#define GEN_ALL				( 0 )
+#define GEN_CAPTURES		( 1 )
+#define GEN_QUIETS			( 2 )
+
+// Action encoding (32 bits):
+//   from | to << 6 | flags << 12 | piece << 16 | captured << 19
+#define ACTION( from, to, flags, piece, captured )	\
+	( ( Action )( ( from ) | ( ( to ) << 6 ) | ( ( flags ) << 12 ) | ( ( piece ) << 16 ) | ( ( captured ) << 19 ) ) )
+#define ACTION_FROM( a )			( ( a ) & 0x3F )
+#define ACTION_TO( a )				( ( ( a ) >> 6 ) & 0x3F )
+#define ACTION_FLAGS( a )			( ( ( a ) >> 12 ) & 0xF )
+#define ACTION_PIECE( a )			( ( PieceType )( ( ( a ) >> 16 ) & 0x7 ) )
+#define ACTION_CAPTURED( a )		( ( PieceType )( ( ( a ) >> 19 ) & 0x7 ) )
+#define IS_CAPTURE( a )				( ACTION_FLAGS( a ) & CAPTURE )
+#define IS_PROMOTION( a )			( ACTION_FLAGS( a ) & PROMOTION )
+#define PROMOTION_PIECE( a )		( promotionPieces[ ACTION_FLAGS( a ) & 0x3 ] )
+
+// Game phase, from PHASE_MAX with all pieces on the
+// board down to zero with only kings and pawns
+#define PHASE_MAX					( 24 )
 
 enum { WHITE, BLACK };
 enum { ME, OPPONENT };
 
+// Action flags
+enum
+	{
+	QUIET			= 0x0,
+	DOUBLE_PUSH		= 0x1,
+	KING_CASTLE		= 0x2,
+	QUEEN_CASTLE	= 0x3,
+	CAPTURE			= 0x4,
+	EN_PASSANT		= 0x5,
+	PROMOTION		= 0x8
+	};
+
 
 /******************************************************
 * Types
 ******************************************************/
-typedef std::bitset<64> Bitboard;
-typedef enum { PAWN, ROOK, KNIGHT, BISHOP, QUEEN, KING } PieceType;
+typedef enum { PAWN, ROOK, KNIGHT, BISHOP, QUEEN, KING, NO_PIECE } PieceType;
+typedef uint32_t Action;
+
+// Everything makeMove() overwrites that can't be
+// recovered from the action itself
+typedef struct
+	{
+	Action		action;
+	Key			key;
+	Key			pawnKey;
+	int8_t		epSquare;
+	uint8_t		castling;
+	int			material[ 2 ];
+	Score		psq[ 2 ];
+	} Undo;
+
+// Frontier entry with a sort key for move ordering
+typedef struct
+	{
+	Action		action;
+	int			score;
+	} ScoredAction;
+
+
+/******************************************************
+* Action List
+* Fixed capacity frontier that lives on the stack of
+* each search call, so generating, ordering and
+* iterating never touch the heap
+******************************************************/
+struct ActionList
+	{
+	ScoredAction	actions[ MAX_ACTIONS ];
+	int				size;
+
+	ActionList() : size( 0 ) {};
+
+	void push( Action action )
+		{
+		actions[ size ].action = action;
+		actions[ size ].score = 0;
+		size++;
+		};
+	ScoredAction* begin() { return actions; };
+	ScoredAction* end() { return actions + size; };
+	ScoredAction& operator[]( int i ) { return actions[ i ]; };
+	};
 
 
 /******************************************************
 * Public Utility Functions
 ******************************************************/
-int bitScanForward( Bitboard bb );
+extern const PieceType promotionPieces[ 4 ];
 int getBitboardIdx( int rank, std::string file );
+int pieceValue( PieceType piece );
 void print_bitboard( Bitboard* bitboard );
+std::string actionToString( Action action );
 
 
 /******************************************************
 * State Class
 ******************************************************/
-class Chess::State: public Chess::GameObject
+class Chess::State
 	{
-	friend Chess::GameManager;
+	public:
+		Bitboard pieces[ 2 ][ 6 ];
 
-	protected:
+		Key key;
+		Key pawnKey;
 
-	public:
-		Bitboard myPawns;
-		Bitboard myKnights;
-		Bitboard myBishops;
-		Bitboard myRooks;
-		Bitboard myQueens;
-		Bitboard myKing;
-
-		Bitboard oppPawns;
-		Bitboard oppKnights;
-		Bitboard oppBishops;
-		Bitboard oppRooks;
-		Bitboard oppQueens;
-		Bitboard oppKing;
-
-		Bitboard misc;
+		// Running evaluation terms per player, kept up to
+		// date by makeMove()
+		int material[ 2 ];
+		Score psq[ 2 ];
 
+		int castling;
+		int epSquare;
 		int score;
-		int historyVal;
-
-		State* parent;
+		int ply;
+		int turn;
 
 		bool color;
 
-		State( Chess::State * parent );
+		Undo undoStack[ MAX_PLY ];
+
 		State( Chess::AI* ai );
+		State( const std::string& fen );
 		State() {};
 		~State() {};
 
-		void Actions( std::vector<Chess::State*>& frontier, int player );
-		int isThreatened( int idx, int to_idx, int from_idx, int player );
-		bool isNonQuiescent();
-		void addMove( std::vector<Chess::State*>& frontier, int from_idx, int to_idx, Bitboard * piece, int player );
+		void copyFrom( const Chess::State& other );
+
+		void Actions( ActionList& frontier );
+		void Captures( ActionList& frontier );
+		void Quiets( ActionList& frontier );
+		void generateMoves( ActionList& frontier, int type );
+		bool canCastle( int flags );
+		bool isValid( Action action );
+		bool isLegal( Action action );
+		Bitboard attackersTo( int idx, Bitboard occ ) const;
+		int isThreatened( int idx, int player );
+		int see( Action action ) const;
+		bool inCheck();
+		bool isRepetition( Action action );
+		void addMove( ActionList& frontier, int from_idx, int to_idx, int flags, PieceType piece );
+		void addPawnMove( ActionList& frontier, int from_idx, int to_idx, int flags );
+		void makeMove( Action action );
+		void unmakeMove();
+		void makeNullMove();
+		void unmakeNullMove();
 		void calcScore();
-		Chess::State& operator= ( Chess::State &rhs );
+		int evaluate();
+		Key computeKey() const;
+		Key computePawnKey() const;
+		void computeEval( int* material, Score* psq ) const;
+		int gamePhase() const;
+		const PawnEntry* pawnStructure() const;
+		Score evalActivity() const;
+		void evalPawns( PawnEntry* entry ) const;
 		bool operator == ( const Chess::State & other ) const;
 
-		// Mutators
-		void setHistoryVal( int x ) { historyVal = x; };
-		int getHistoryVal() { return historyVal; };
+		// Accessors
+		Bitboard sidePieces( int player ) const
+			{
+			return pieces[ player ][ PAWN ] | pieces[ player ][ ROOK ] | pieces[ player ][ KNIGHT ] |
+				   pieces[ player ][ BISHOP ] | pieces[ player ][ QUEEN ] | pieces[ player ][ KING ];
+			}
+		int sideColor( int player ) const { return color ^ player; };
+		bool hasNonPawnMaterial( int player ) const
+			{
+			return( pieces[ player ][ KNIGHT ] | pieces[ player ][ BISHOP ] | pieces[ player ][ ROOK ] | pieces[ player ][ QUEEN ] ) != 0;
+			}
+		PieceType pieceAt( int player, int idx ) const
+			{
+			for( int i = PAWN; i < NO_PIECE; i++ )
+				{
+				if( pieces[ player ][ i ] & BIT( idx ) )
+					return ( PieceType )i;
+				}
+			return NO_PIECE;
+			}
 
 	};
-	void printMoves( std::vector<Chess::State*>* moves );
+	void printMoves( ActionList& moves );
 
 
-	/**************************************************************
+	/**************************************************************
 	* State Hash Functor
-	* Overloads std::hash to handle State types. Relies on Boost's
-	* hash_combine() function. Only hashs board layout directly;
-	* other members of state are irrelevant for hashing.
+	* Overloads std::hash to handle State types. The Zobrist key
+	* is already maintained by makeMove(), so this just returns it.
 	**************************************************************/
 	struct StateHash
 		{
 		std::size_t operator()( const Chess::State& s ) const
 			{
-			std::size_t seed = 0;
-			boost::hash_combine( seed, std::hash<Bitboard>{}( s.myPawns ) );
-			boost::hash_combine( seed, std::hash<Bitboard>{}( s.myRooks ) );
-			boost::hash_combine( seed, std::hash<Bitboard>{}( s.myKnights ) );
-			boost::hash_combine( seed, std::hash<Bitboard>{}( s.myBishops ) );
-			boost::hash_combine( seed, std::hash<Bitboard>{}( s.myQueens ) );
-			boost::hash_combine( seed, std::hash<Bitboard>{}( s.myKing ) );
-			boost::hash_combine( seed, std::hash<Bitboard>{}( s.oppPawns ) );
-			boost::hash_combine( seed, std::hash<Bitboard>{}( s.oppRooks ) );
-			boost::hash_combine( seed, std::hash<Bitboard>{}( s.oppKnights ) );
-			boost::hash_combine( seed, std::hash<Bitboard>{}( s.oppBishops ) );
-			boost::hash_combine( seed, std::hash<Bitboard>{}( s.oppQueens ) );
-			boost::hash_combine( seed, std::hash<Bitboard>{}( s.oppKing ) );
-			return seed;
-			}
-		};
-
-
-	/**************************************************************
-	* State Sort Functor
-	* Allows std::sort to handle State types. Bases the comparison
-	* on each state's history table value, returning the higher
-	* value to result in a decending sort
-	**************************************************************/
-	struct StateSort
-		{
-		inline bool operator() ( const Chess::State* x, const Chess::State* y )
-			{
-			return( x->historyVal > y->historyVal );
+			return ( std::size_t )s.key;
 			}
 		};
 
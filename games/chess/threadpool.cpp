@@ -0,0 +1,528 @@
+/**************************************************************
+* threadpool.cpp
+* Definitions for the chess work-stealing thread pool
+* CS5400, FS 2016
+* Stuart Miller
+**************************************************************/
+
+
+/******************************************************
+* Includes
+******************************************************/
+#include "threadpool.h"
+#include <system_error>
+#ifdef _WIN32
+#include <windows.h>
+#elif defined( __linux__ )
+#include <sched.h>
+#endif
+
+
+/******************************************************
+* Local Variables
+******************************************************/
+// Index of the worker running on this thread, or -1
+static thread_local int workerIdx = -1;
+// Jobs this thread is running from inside wait() calls
+static thread_local int helpDepth = 0;
+
+
+/******************************************************
+* Global Thread Pool
+******************************************************/
+ThreadPool pool;
+
+
+/******************************************************
+* Deque Constructor
+******************************************************/
+WorkDeque::WorkDeque()
+	{
+	top = 0;
+	bottom = 0;
+	for( int i = 0; i < DEQUE_SZ; i++ )
+		{
+		jobs[ i ] = nullptr;
+		}
+	}
+
+
+/******************************************************
+* Deque Push
+* Owner only. Returns false if the deque is full.
+******************************************************/
+bool WorkDeque::push( Job* job )
+	{
+	int64_t b = bottom.load( std::memory_order_relaxed );
+	int64_t t = top.load( std::memory_order_acquire );
+	if( b - t >= DEQUE_SZ )
+		{
+		return false;
+		}
+	jobs[ b % DEQUE_SZ ].store( job, std::memory_order_relaxed );
+	std::atomic_thread_fence( std::memory_order_release );
+	bottom.store( b + 1, std::memory_order_relaxed );
+	return true;
+	}
+
+
+/******************************************************
+* Deque Take
+* Owner only. Pops the newest job, racing any thieves
+* for the last one.
+******************************************************/
+Job* WorkDeque::take()
+	{
+	int64_t b = bottom.load( std::memory_order_relaxed ) - 1;
+	bottom.store( b, std::memory_order_relaxed );
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	int64_t t = top.load( std::memory_order_relaxed );
+	Job* job = nullptr;
+	if( t <= b )
+		{
+		job = jobs[ b % DEQUE_SZ ].load( std::memory_order_relaxed );
+		if( t == b )
+			{
+			if( !top.compare_exchange_strong( t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) )
+				{
+				job = nullptr;
+				}
+			bottom.store( b + 1, std::memory_order_relaxed );
+			}
+		}
+	else
+		{
+		bottom.store( b + 1, std::memory_order_relaxed );
+		}
+	return job;
+	}
+
+
+/******************************************************
+* Deque Steal
+* Any thread. Pops the oldest job, or returns null if
+* the deque is empty or another thread won the race.
+******************************************************/
+Job* WorkDeque::steal()
+	{
+	int64_t t = top.load( std::memory_order_acquire );
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	int64_t b = bottom.load( std::memory_order_acquire );
+	Job* job = nullptr;
+	if( t < b )
+		{
+		job = jobs[ t % DEQUE_SZ ].load( std::memory_order_relaxed );
+		if( !top.compare_exchange_strong( t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) )
+			{
+			job = nullptr;
+			}
+		}
+	return job;
+	}
+
+
+/******************************************************
+* Constructor
+* Starts out with no workers; start() must be called
+* to spin them up
+******************************************************/
+ThreadPool::ThreadPool()
+	{
+	running = false;
+	queued = 0;
+	sleepers = 0;
+	waiters = 0;
+	}
+
+
+/******************************************************
+* Destructor
+******************************************************/
+ThreadPool::~ThreadPool()
+	{
+	stop();
+	}
+
+
+/******************************************************
+* Start
+* Launches numWorkers threads, optionally pinning each
+* to its own core. Core 0 is left to the thread that
+* owns the pool.
+******************************************************/
+void ThreadPool::start( int numWorkers, bool pinned )
+	{
+	stop();
+
+	running = true;
+	for( int i = 0; i < numWorkers; i++ )
+		{
+		workers.push_back( new Worker );
+		}
+	for( int i = 0; i < numWorkers; i++ )
+		{
+		launch( i );
+		if( pinned )
+			{
+			pin( i );
+			}
+		}
+	return;
+	}
+
+
+/******************************************************
+* Stop
+* Signals every worker to exit and joins them. Must not
+* be called while any task is still outstanding; jobs
+* left queued are dropped without being run.
+******************************************************/
+void ThreadPool::stop()
+	{
+	if( !running )
+		{
+		return;
+		}
+		{
+		std::lock_guard<std::mutex> guard( sleepLock );
+		running = false;
+		}
+	wake.notify_all();
+	Job* job;
+	for( int i = 0; i < size(); i++ )
+		{
+#ifdef _WIN32
+		WaitForSingleObject( workers[ i ]->thread, INFINITE );
+		CloseHandle( workers[ i ]->thread );
+#else
+		pthread_join( workers[ i ]->thread, nullptr );
+#endif
+		while( ( job = workers[ i ]->jobs.take() ) != nullptr )
+			{
+			delete job;
+			}
+		delete workers[ i ];
+		}
+	workers.clear();
+	for( size_t i = 0; i < shared.size(); i++ )
+		{
+		delete shared[ i ];
+		}
+	shared.clear();
+	queued = 0;
+	return;
+	}
+
+
+/******************************************************
+* Submit
+* Queues a task under the passed group. Workers push
+* onto their own deque, anyone else onto the shared
+* queue. If the pool has no workers, or the worker's
+* deque is full, the task is run right away.
+******************************************************/
+void ThreadPool::submit( TaskGroup& group, Task task )
+	{
+	Job* job = new Job;
+	job->task = task;
+	job->group = &group;
+	group.pending++;
+
+	if( workerIdx >= 0 && workerIdx < size() )
+		{
+		if( !workers[ workerIdx ]->jobs.push( job ) )
+			{
+			run( job );
+			return;
+			}
+		}
+	else if( size() > 0 )
+		{
+		std::lock_guard<std::mutex> guard( sharedLock );
+		shared.push_back( job );
+		}
+	else
+		{
+		run( job );
+		return;
+		}
+
+	// Wake a parked worker
+	queued++;
+	if( sleepers > 0 )
+		{
+		std::lock_guard<std::mutex> guard( sleepLock );
+		wake.notify_one();
+		}
+	return;
+	}
+
+
+/******************************************************
+* Wait
+* Blocks until every task in the group has finished.
+* The waiting thread runs queued jobs in the meantime,
+* so nested waits can never starve the pool. Each of
+* those jobs nests on this thread's stack, so past
+* HELP_DEPTH_MAX the thread only runs the group's own
+* jobs still in its queue, and then parks until the
+* ones taken by other threads are done.
+******************************************************/
+void ThreadPool::wait( TaskGroup& group )
+	{
+	Job* job;
+	bool capped;
+	while( group.pending > 0 )
+		{
+		capped = ( helpDepth >= HELP_DEPTH_MAX );
+		job = ( capped ? popOwn( workerIdx, group ) : pop( workerIdx ) );
+		if( job != nullptr )
+			{
+			helpDepth++;
+			run( job );
+			helpDepth--;
+			}
+		else if( !capped )
+			{
+			std::this_thread::yield();
+			}
+		else
+			{
+			std::unique_lock<std::mutex> guard( doneLock );
+			waiters++;
+			done.wait( guard, [ &group ]{ return group.pending <= 0; } );
+			waiters--;
+			}
+		}
+	return;
+	}
+
+
+/******************************************************
+* Pop
+* Takes the next job for the passed worker: its own
+* newest job, then the shared queue, then the oldest
+* job of another worker
+******************************************************/
+Job* ThreadPool::pop( int self )
+	{
+	Job* job = nullptr;
+	int i, victim;
+	if( queued <= 0 )
+		{
+		return nullptr;
+		}
+
+	// Own deque
+	if( self >= 0 && self < size() )
+		{
+		job = workers[ self ]->jobs.take();
+		}
+
+	// Shared queue
+	if( job == nullptr )
+		{
+		std::lock_guard<std::mutex> guard( sharedLock );
+		if( !shared.empty() )
+			{
+			job = shared.front();
+			shared.pop_front();
+			}
+		}
+
+	// Steal
+	for( i = 1; job == nullptr && i <= size(); i++ )
+		{
+		victim = ( self + i ) % size();
+		if( victim >= 0 && victim != self )
+			{
+			job = workers[ victim ]->jobs.steal();
+			}
+		}
+
+	if( job != nullptr )
+		{
+		queued--;
+		}
+	return job;
+	}
+
+
+/******************************************************
+* Pop Own
+* Takes the newest job the calling thread queued, if it
+* belongs to the passed group. Anything the thread
+* queued after the group's jobs has already finished by
+* the time it waits on the group, so those jobs are
+* always the newest ones left.
+******************************************************/
+Job* ThreadPool::popOwn( int self, TaskGroup& group )
+	{
+	Job* job = nullptr;
+	if( queued <= 0 )
+		{
+		return nullptr;
+		}
+
+	if( self >= 0 && self < size() )
+		{
+		job = workers[ self ]->jobs.take();
+		if( job != nullptr && job->group != &group )
+			{
+			workers[ self ]->jobs.push( job );
+			job = nullptr;
+			}
+		}
+	else
+		{
+		std::lock_guard<std::mutex> guard( sharedLock );
+		if( !shared.empty() && shared.back()->group == &group )
+			{
+			job = shared.back();
+			shared.pop_back();
+			}
+		}
+
+	if( job != nullptr )
+		{
+		queued--;
+		}
+	return job;
+	}
+
+
+/******************************************************
+* Run
+* Executes a job and retires it from its group, waking
+* any thread parked in wait() once the group is empty.
+* The group may be gone as soon as its count reaches
+* zero, so it isn't touched after that.
+******************************************************/
+void ThreadPool::run( Job* job )
+	{
+	TaskGroup* group = job->group;
+	job->task();
+	delete job;
+	if( --group->pending == 0 && waiters > 0 )
+		{
+		std::lock_guard<std::mutex> guard( doneLock );
+		done.notify_all();
+		}
+	return;
+	}
+
+
+/******************************************************
+* Launch
+* Creates the thread for worker self with a stack of
+* WORKER_STACK_SZ bytes, rather than the platform
+* default
+******************************************************/
+void ThreadPool::launch( int self )
+	{
+	Worker* worker = workers[ self ];
+	worker->owner = this;
+	worker->self = self;
+#ifdef _WIN32
+	worker->thread = CreateThread( nullptr, WORKER_STACK_SZ, workerMain, worker, STACK_SIZE_PARAM_IS_A_RESERVATION, nullptr );
+	if( worker->thread == nullptr )
+		{
+		throw std::system_error( ( int )GetLastError(), std::system_category(), "Failed to start pool thread" );
+		}
+#else
+	pthread_attr_t attr;
+	int err;
+	pthread_attr_init( &attr );
+	pthread_attr_setstacksize( &attr, WORKER_STACK_SZ );
+	err = pthread_create( &worker->thread, &attr, workerMain, worker );
+	pthread_attr_destroy( &attr );
+	if( err != 0 )
+		{
+		throw std::system_error( err, std::system_category(), "Failed to start pool thread" );
+		}
+#endif
+	return;
+	}
+
+
+/******************************************************
+* Worker Main
+* Entry point of a worker thread
+******************************************************/
+#ifdef _WIN32
+unsigned long __stdcall ThreadPool::workerMain( void* arg )
+	{
+	Worker* worker = ( Worker* )arg;
+	worker->owner->workerLoop( worker->self );
+	return 0;
+	}
+#else
+void* ThreadPool::workerMain( void* arg )
+	{
+	Worker* worker = ( Worker* )arg;
+	worker->owner->workerLoop( worker->self );
+	return nullptr;
+	}
+#endif
+
+
+/******************************************************
+* Worker Loop
+* Runs jobs until the pool is stopped. After SPIN_COUNT
+* empty polls the worker parks until submit() or stop()
+* wakes it.
+******************************************************/
+void ThreadPool::workerLoop( int self )
+	{
+	Job* job;
+	int idle = 0;
+	workerIdx = self;
+	while( running )
+		{
+		job = pop( self );
+		if( job != nullptr )
+			{
+			run( job );
+			idle = 0;
+			}
+		else if( ++idle < SPIN_COUNT )
+			{
+			std::this_thread::yield();
+			}
+		else
+			{
+			std::unique_lock<std::mutex> guard( sleepLock );
+			sleepers++;
+			wake.wait( guard, [ this ]{ return queued > 0 || !running; } );
+			sleepers--;
+			idle = 0;
+			}
+		}
+	return;
+	}
+
+
+/******************************************************
+* Pin
+* Binds a worker to core self + 1, wrapping around the
+* available cores. Not supported on every platform, in
+* which case the worker is left to the scheduler.
+******************************************************/
+void ThreadPool::pin( int self )
+	{
+	int cores = ( int )std::thread::hardware_concurrency();
+	if( cores <= 0 )
+		{
+		return;
+		}
+	int core = ( self + 1 ) % cores;
+#ifdef _WIN32
+	SetThreadAffinityMask( workers[ self ]->thread, ( DWORD_PTR )1 << core );
+#elif defined( __linux__ )
+	cpu_set_t set;
+	CPU_ZERO( &set );
+	CPU_SET( core, &set );
+	pthread_setaffinity_np( workers[ self ]->thread, sizeof( set ), &set );
+#endif
+	return;
+	}
@@ -0,0 +1,147 @@
+/**************************************************************
+* threadpool.h
+* Declarations for the chess work-stealing thread pool
+* CS5400, FS 2016
+* Stuart Miller
+**************************************************************/
+#ifndef JOUEUR_CHESS_THREADPOOL_H
+#define JOUEUR_CHESS_THREADPOOL_H
+
+/******************************************************
+* Includes
+******************************************************/
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+
+/******************************************************
+* Compiler Constants
+******************************************************/
+#define DEQUE_SZ			( 1024 )
+#define SPIN_COUNT			( 64 )
+#define HELP_DEPTH_MAX		( 4 )
+#define WORKER_STACK_SZ		( 16 * 1024 * 1024 )
+
+
+/******************************************************
+* Types
+******************************************************/
+typedef std::function<void()> Task;
+#ifdef _WIN32
+typedef void* NativeThread;
+#else
+typedef pthread_t NativeThread;
+#endif
+
+// Counts outstanding tasks from one submitter, so that
+// it can wait on just the work it handed out
+struct TaskGroup
+	{
+	std::atomic<int>	pending;
+
+	TaskGroup() : pending( 0 ) {};
+	};
+
+// A submitted task and the group it belongs to
+typedef struct
+	{
+	Task		task;
+	TaskGroup*	group;
+	} Job;
+
+
+/******************************************************
+* Work Stealing Deque
+* Fixed capacity Chase-Lev deque. Only the owning worker
+* may push() and take() at the bottom; any thread may
+* steal() from the top. No locks are taken.
+******************************************************/
+class WorkDeque
+	{
+	public:
+		WorkDeque();
+
+		bool push( Job* job );
+		Job* take();
+		Job* steal();
+
+	private:
+		std::atomic<int64_t>	top;
+		std::atomic<int64_t>	bottom;
+		std::atomic<Job*>		jobs[ DEQUE_SZ ];
+	};
+
+
+/******************************************************
+* Thread Pool Class
+* Each worker owns a deque of jobs. Workers take their
+* own newest job first and steal the oldest job from
+* the others when they run dry, parking once nothing
+* has turned up for a while. Threads outside the pool
+* submit through a shared queue. Workers are created
+* with a fixed stack size, since waiting threads run
+* other jobs on top of their own.
+******************************************************/
+class ThreadPool
+	{
+	public:
+		ThreadPool();
+		~ThreadPool();
+
+		void start( int numWorkers, bool pinned );
+		void stop();
+		int size() const { return ( int )workers.size(); };
+
+		void submit( TaskGroup& group, Task task );
+		void wait( TaskGroup& group );
+
+	private:
+		typedef struct
+			{
+			NativeThread	thread;
+			ThreadPool*		owner;
+			int				self;
+			WorkDeque		jobs;
+			} Worker;
+
+		std::vector<Worker*>	workers;
+		std::mutex				sharedLock;
+		std::deque<Job*>		shared;
+		std::mutex				sleepLock;
+		std::condition_variable	wake;
+		std::mutex				doneLock;
+		std::condition_variable	done;
+		std::atomic<bool>		running;
+		std::atomic<int>		queued;
+		std::atomic<int>		sleepers;
+		std::atomic<int>		waiters;
+
+		Job* pop( int self );
+		Job* popOwn( int self, TaskGroup& group );
+		void run( Job* job );
+		void launch( int self );
+		void workerLoop( int self );
+		void pin( int self );
+#ifdef _WIN32
+		static unsigned long __stdcall workerMain( void* arg );
+#else
+		static void* workerMain( void* arg );
+#endif
+	};
+
+
+/******************************************************
+* Global Thread Pool
+******************************************************/
+extern ThreadPool pool;
+
+#endif
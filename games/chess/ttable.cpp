@@ -0,0 +1,185 @@
+/**************************************************************
+* ttable.cpp
+* Definitions for the chess transposition table
+* CS5400, FS 2016
+* Stuart Miller
+**************************************************************/
+
+
+/******************************************************
+* Includes
+******************************************************/
+#include "ttable.h"
+#include <climits>
+
+
+/******************************************************
+* Macros
+******************************************************/
+#define PACK_DATA( action, score, depth, bound, age )	\
+	( ( uint64_t )( action ) | ( ( uint64_t )( bound ) << 22 ) | ( ( uint64_t )( depth ) << 24 ) | \
+	  ( ( uint64_t )( ( age ) & 0x3 ) << 30 ) | ( ( uint64_t )( uint32_t )( score ) << 32 ) )
+#define DATA_ACTION( d )		( ( Action )( ( d ) & 0x3FFFFF ) )
+#define DATA_BOUND( d )			( ( Bound )( ( ( d ) >> 22 ) & 0x3 ) )
+#define DATA_DEPTH( d )			( ( int )( ( ( d ) >> 24 ) & 0x3F ) )
+#define DATA_AGE( d )			( ( int )( ( ( d ) >> 30 ) & 0x3 ) )
+#define DATA_SCORE( d )			( ( int )( int32_t )( uint32_t )( ( d ) >> 32 ) )
+
+
+/******************************************************
+* Global Transposition Table
+******************************************************/
+TranspositionTable tt;
+
+
+/******************************************************
+* Constructor
+* Starts out empty; resize() must be called before the
+* table is used
+******************************************************/
+TranspositionTable::TranspositionTable()
+	{
+	memory	= nullptr;
+	buckets	= nullptr;
+	mask	= 0;
+	age		= 0;
+	}
+
+
+/******************************************************
+* Destructor
+******************************************************/
+TranspositionTable::~TranspositionTable()
+	{
+	delete[] memory;
+	}
+
+
+/******************************************************
+* Resize
+* Allocates the largest power of two number of buckets
+* that fits in sizeMb, aligned to a cache line so that
+* a probe only ever touches one line
+******************************************************/
+void TranspositionTable::resize( int sizeMb )
+	{
+	std::size_t count = 1;
+	std::size_t bytes = ( std::size_t )( sizeMb > 0 ? sizeMb : 1 ) * BYTES_PER_MB;
+	while( count * 2 * sizeof( TTBucket ) <= bytes )
+		{
+		count *= 2;
+		}
+
+	delete[] memory;
+	memory	= new char[ count * sizeof( TTBucket ) + TT_CACHE_LINE ];
+	buckets	= ( TTBucket* )( ( ( std::uintptr_t )memory + TT_CACHE_LINE - 1 ) & ~( std::uintptr_t )( TT_CACHE_LINE - 1 ) );
+	mask	= count - 1;
+	clear();
+	return;
+	}
+
+
+/******************************************************
+* Clear
+* Wipes every entry in the table. Must not be called
+* while a search is running.
+******************************************************/
+void TranspositionTable::clear()
+	{
+	std::size_t i;
+	int j;
+	for( i = 0; buckets != nullptr && i <= mask; i++ )
+		{
+		for( j = 0; j < TT_BUCKET_SZ; j++ )
+			{
+			buckets[ i ].slots[ j ].check.store( 0, std::memory_order_relaxed );
+			buckets[ i ].slots[ j ].data.store( 0, std::memory_order_relaxed );
+			}
+		}
+	age = 0;
+	return;
+	}
+
+
+/******************************************************
+* New Search
+* Bumps the table age, so that entries left over from
+* previous turns are the first to be replaced
+******************************************************/
+void TranspositionTable::newSearch()
+	{
+	age++;
+	return;
+	}
+
+
+/******************************************************
+* Probe
+* Copies the entry stored for key into entry. Returns
+* false if the position is not in the table, or if its
+* slot was torn by a concurrent store.
+******************************************************/
+bool TranspositionTable::probe( Key key, TTEntry& entry ) const
+	{
+	const TTBucket& b = bucket( key );
+	uint64_t data;
+	for( int i = 0; i < TT_BUCKET_SZ; i++ )
+		{
+		data = b.slots[ i ].data.load( std::memory_order_relaxed );
+		if( ( b.slots[ i ].check.load( std::memory_order_relaxed ) ^ data ) == key && DATA_BOUND( data ) != BOUND_NONE )
+			{
+			entry.action	= DATA_ACTION( data );
+			entry.score		= DATA_SCORE( data );
+			entry.depth		= DATA_DEPTH( data );
+			entry.bound		= DATA_BOUND( data );
+			entry.age		= DATA_AGE( data );
+			return true;
+			}
+		}
+	return false;
+	}
+
+
+/******************************************************
+* Store
+* Writes a search result into the key's bucket. An
+* entry for the same position is overwritten; otherwise
+* the shallowest entry is replaced, preferring entries
+* from earlier turns.
+******************************************************/
+void TranspositionTable::store( Key key, Action action, int score, int depth, Bound bound )
+	{
+	TTBucket& b = bucket( key );
+	TTSlot* replace = &b.slots[ 0 ];
+	uint64_t data, replaceData = 0;
+	int i, val, worst = INT_MAX;
+	for( i = 0; i < TT_BUCKET_SZ; i++ )
+		{
+		TTSlot& slot = b.slots[ i ];
+		data = slot.data.load( std::memory_order_relaxed );
+		if( ( slot.check.load( std::memory_order_relaxed ) ^ data ) == key || DATA_BOUND( data ) == BOUND_NONE )
+			{
+			replace = &slot;
+			replaceData = data;
+			break;
+			}
+		val = DATA_DEPTH( data ) - ( ( ( age - DATA_AGE( data ) ) & 0x3 ) * 8 );
+		if( val < worst )
+			{
+			worst = val;
+			replace = &slot;
+			replaceData = data;
+			}
+		}
+
+	// Keep the old best action if this search didn't find one
+	if( action == NULL_ACTION && ( replace->check.load( std::memory_order_relaxed ) ^ replaceData ) == key )
+		{
+		action = DATA_ACTION( replaceData );
+		}
+
+	data = PACK_DATA( action, score, depth > TT_MAX_DEPTH ? TT_MAX_DEPTH : depth, bound, age );
+	replace->check.store( key ^ data, std::memory_order_relaxed );
+	replace->data.store( data, std::memory_order_relaxed );
+	return;
+	}
@@ -0,0 +1,90 @@
+/**************************************************************
+* ttable.h
+* Declarations for the chess transposition table
+* CS5400, FS 2016
+* Stuart Miller
+**************************************************************/
+#ifndef JOUEUR_CHESS_TTABLE_H
+#define JOUEUR_CHESS_TTABLE_H
+
+/******************************************************
+* Includes
+******************************************************/
+#include "state.h"
+#include <atomic>
+
+
+/******************************************************
+* Compiler Constants
+******************************************************/
+#define TT_BUCKET_SZ		( 4 )
+#define TT_CACHE_LINE		( 64 )
+#define BYTES_PER_MB		( 1024 * 1024 )
+#define TT_MAX_DEPTH		( 63 )
+
+
+/******************************************************
+* Types
+******************************************************/
+typedef enum { BOUND_NONE, BOUND_UPPER, BOUND_LOWER, BOUND_EXACT } Bound;
+
+// Unpacked copy of a stored search result
+typedef struct
+	{
+	Action		action;
+	int			score;
+	int			depth;
+	Bound		bound;
+	int			age;
+	} TTEntry;
+
+// A single slot as it sits in memory. Everything but the
+// key is packed into data:
+//   action( 22 ) | bound << 22 | depth << 24 | age << 30 | score << 32
+// and check holds key ^ data. Both halves are written
+// without a lock, so a slot torn by two threads storing
+// at once simply fails the check on the next probe.
+typedef struct
+	{
+	std::atomic<uint64_t>	check;
+	std::atomic<uint64_t>	data;
+	} TTSlot;
+
+// One cache line worth of slots sharing an index
+typedef struct
+	{
+	TTSlot		slots[ TT_BUCKET_SZ ];
+	} TTBucket;
+
+
+/******************************************************
+* Transposition Table Class
+******************************************************/
+class TranspositionTable
+	{
+	public:
+		TranspositionTable();
+		~TranspositionTable();
+
+		void resize( int sizeMb );
+		void clear();
+		void newSearch();
+		bool probe( Key key, TTEntry& entry ) const;
+		void store( Key key, Action action, int score, int depth, Bound bound );
+
+	private:
+		char*		memory;
+		TTBucket*	buckets;
+		std::size_t	mask;
+		int			age;
+
+		TTBucket& bucket( Key key ) const { return buckets[ key & mask ]; };
+	};
+
+
+/******************************************************
+* Global Transposition Table
+******************************************************/
+extern TranspositionTable tt;
+
+#endif
@@ -0,0 +1,67 @@
+/**************************************************************
+* zobrist.cpp
+* Definitions for the chess Zobrist hash keys
+* CS5400, FS 2016
+* Stuart Miller
+**************************************************************/
+
+
+/******************************************************
+* Includes
+******************************************************/
+#include "zobrist.h"
+#include "attacks.h"
+
+
+/******************************************************
+* Local Variables
+******************************************************/
+static bool initialized = false;
+static Key seed = 1070372ULL;
+
+
+/******************************************************
+* Global Hash Keys
+******************************************************/
+Key		pieceKeys[ 2 ][ 6 ][ 64 ];
+Key		castlingKeys[ 16 ];
+Key		epKeys[ 8 ];
+Key		sideKey;
+
+
+/******************************************************
+* Initialize Zobrist Keys
+* Fills every key table. Only needs to be called once
+* per process, before any state is constructed.
+******************************************************/
+void initZobrist()
+	{
+	if( initialized )
+		{
+		return;
+		}
+
+	int c, p, sq, i;
+	for( c = 0; c < 2; c++ )
+		{
+		for( p = 0; p < 6; p++ )
+			{
+			for( sq = 0; sq < 64; sq++ )
+				{
+				pieceKeys[ c ][ p ][ sq ] = random64( seed );
+				}
+			}
+		}
+	for( i = 0; i < 16; i++ )
+		{
+		castlingKeys[ i ] = random64( seed );
+		}
+	for( i = 0; i < 8; i++ )
+		{
+		epKeys[ i ] = random64( seed );
+		}
+	sideKey = random64( seed );
+
+	initialized = true;
+	return;
+	}
@@ -0,0 +1,39 @@
+/**************************************************************
+* zobrist.h
+* Declarations for the chess Zobrist hash keys
+* CS5400, FS 2016
+* Stuart Miller
+**************************************************************/
+#ifndef JOUEUR_CHESS_ZOBRIST_H
+#define JOUEUR_CHESS_ZOBRIST_H
+
+/******************************************************
+* Includes
+******************************************************/
+#include "bitboard.h"
+
+
+/******************************************************
+* Types
+******************************************************/
+typedef uint64_t Key;
+
+
+/******************************************************
+* Hash Keys
+* Piece keys are indexed by absolute color (not by
+* ME/OPPONENT), then piece type, then square. The side
+* key is folded in whenever black is to move.
+******************************************************/
+extern Key		pieceKeys[ 2 ][ 6 ][ 64 ];
+extern Key		castlingKeys[ 16 ];
+extern Key		epKeys[ 8 ];
+extern Key		sideKey;
+
+
+/******************************************************
+* Function Declarations
+******************************************************/
+void initZobrist();
+
+#endif
@@ -0,0 +1,170 @@
+/**************************************************************
+* perft.cpp
+* Standalone move generator benchmark and correctness check
+* CS5400, FS 2016
+* Stuart Miller
+*
+* Usage:
+*   perft                 Runs the reference positions and
+*                         checks every count
+*   perft <depth> [fen]   Counts leaf nodes of one position,
+*                         default the starting position, with
+*                         per-move divide output
+*
+* The generator refuses moves that repeat the last four, so
+* counts can drift from the published ones past depth 7.
+**************************************************************/
+
+
+/******************************************************
+* Includes
+******************************************************/
+#include "../games/chess/state.h"
+#include "../games/chess/attacks.h"
+#include "../games/chess/zobrist.h"
+#include "../games/chess/globals.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+
+/******************************************************
+* Compiler Constants
+******************************************************/
+#define START_FEN	"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+
+/******************************************************
+* Types
+******************************************************/
+typedef struct
+	{
+	const char*	fen;
+	int			depth;
+	long long	nodes;
+	} PerftPosition;
+
+
+/******************************************************
+* Local Variables
+******************************************************/
+// Standard positions that exercise castling, en passant,
+// promotion and pins
+static const PerftPosition positions[] = {
+	{ START_FEN,																	5, 4865609 },
+	{ "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",		4, 4085603 },
+	{ "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",									6, 11030083 },
+	{ "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",			5, 15833292 },
+	{ "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",					4, 2103487 },
+	{ "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",	4, 3894594 },
+	};
+
+
+/******************************************************
+* Perft
+* Counts the leaf nodes depth plies below state. The
+* generator only produces legal moves, so the last ply
+* is counted from the size of the list without playing
+* the moves out.
+******************************************************/
+static long long perft( Chess::State* state, int depth )
+	{
+	ActionList frontier;
+	long long nodes = 0;
+
+	state->Actions( frontier );
+	if( depth <= 1 )
+		{
+		return frontier.size;
+		}
+	for( ScoredAction* runner = frontier.begin(); runner != frontier.end(); runner++ )
+		{
+		state->makeMove( runner->action );
+		nodes += perft( state, depth - 1 );
+		state->unmakeMove();
+		}
+	return nodes;
+	}
+
+
+/******************************************************
+* Divide
+* Runs perft below each root move and prints the counts,
+* so a wrong total can be traced to the move under it
+******************************************************/
+static long long divide( Chess::State* state, int depth )
+	{
+	ActionList frontier;
+	long long nodes = 0;
+	long long count;
+
+	state->Actions( frontier );
+	for( ScoredAction* runner = frontier.begin(); runner != frontier.end(); runner++ )
+		{
+		state->makeMove( runner->action );
+		count = ( depth > 1 ? perft( state, depth - 1 ) : 1 );
+		state->unmakeMove();
+		printf( "  %-16s %lld\n", actionToString( runner->action ).c_str(), count );
+		nodes += count;
+		}
+	return nodes;
+	}
+
+
+/******************************************************
+* Timed Run
+* Returns the seconds taken by a perft or divide call
+******************************************************/
+static double timedRun( Chess::State* state, int depth, bool split, long long& nodes )
+	{
+	auto start = std::chrono::steady_clock::now();
+	nodes = ( split ? divide( state, depth ) : perft( state, depth ) );
+	return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+	}
+
+
+/******************************************************
+* Main
+******************************************************/
+int main( int argc, char* argv[] )
+	{
+	long long nodes, total = 0;
+	double seconds, totalSeconds = 0;
+	int failures = 0;
+	int depth;
+	size_t i;
+
+	initGlobals();
+	initAttacks();
+	initZobrist();
+
+	// Single position with divide output
+	if( argc > 1 )
+		{
+		depth = std::atoi( argv[ 1 ] );
+		if( depth < 1 )
+			{
+			fprintf( stderr, "Usage: %s [depth [fen]]\n  depth must be at least 1\n", argv[ 0 ] );
+			return 1;
+			}
+		Chess::State state( std::string( argc > 2 ? argv[ 2 ] : START_FEN ) );
+		seconds = timedRun( &state, depth, true, nodes );
+		printf( "Nodes: %lld\nTime: %.3fs\nSpeed: %.1f Mnps\n", nodes, seconds, nodes / seconds / 1e6 );
+		return 0;
+		}
+
+	// Reference suite
+	for( i = 0; i < sizeof( positions ) / sizeof( positions[ 0 ] ); i++ )
+		{
+		Chess::State state( std::string( positions[ i ].fen ) );
+		seconds = timedRun( &state, positions[ i ].depth, false, nodes );
+		printf( "%s depth %d: %lld (expected %lld) %.3fs %.1f Mnps\n", nodes == positions[ i ].nodes ? "OK  " : "FAIL",
+				positions[ i ].depth, nodes, positions[ i ].nodes, seconds, nodes / seconds / 1e6 );
+		failures += ( nodes != positions[ i ].nodes );
+		total += nodes;
+		totalSeconds += seconds;
+		}
+	printf( "%d failed, %lld nodes in %.3fs, %.1f Mnps\n", failures, total, totalSeconds, total / totalSeconds / 1e6 );
+	return( failures ? 1 : 0 );
+	}